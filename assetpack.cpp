@@ -0,0 +1,167 @@
+//Memory mapped asset archive
+#include "assetpack.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+AssetPack::AssetPack()
+{
+    //Initialize
+    mBase = NULL;
+    mSize = 0;
+    mEntries = NULL;
+    mCount = 0;
+#ifdef _WIN32
+    mFile = INVALID_HANDLE_VALUE;
+    mMapping = NULL;
+#endif
+}
+
+AssetPack::~AssetPack()
+{
+    //Deallocate
+    close();
+}
+
+bool AssetPack::open(const char* path)
+{
+    //Get rid of a preexisting mapping
+    close();
+
+#ifdef _WIN32
+    mFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(mFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(mFile, &size) || size.QuadPart == 0)
+    {
+        close();
+        return false;
+    }
+    mSize = (size_t)size.QuadPart;
+    mMapping = CreateFileMappingA(mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(mMapping != NULL)
+    {
+        mBase = (const uint8_t*)MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+    }
+    if(mBase == NULL)
+    {
+        printf("Unable to map %s!\n", path);
+        close();
+        return false;
+    }
+#else
+    int fd = ::open(path, O_RDONLY);
+    if(fd == -1)
+    {
+        return false;
+    }
+    struct stat info;
+    if(fstat(fd, &info) == -1 || info.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    mSize = (size_t)info.st_size;
+    void* base = mmap(NULL, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    //The mapping keeps the file alive
+    ::close(fd);
+    if(base == MAP_FAILED)
+    {
+        printf("Unable to map %s!\n", path);
+        mSize = 0;
+        return false;
+    }
+    mBase = (const uint8_t*)base;
+#endif
+
+    //Check the header and that every entry lies inside the file
+    const PackHeader* header = (const PackHeader*)mBase;
+    bool valid = mSize >= sizeof(PackHeader) && memcmp(header->magic, PACK_MAGIC, 4) == 0 && header->version == PACK_VERSION
+                 && header->count <= (mSize - sizeof(PackHeader)) / sizeof(PackEntry);
+    if(valid)
+    {
+        mEntries = (const PackEntry*)(mBase + sizeof(PackHeader));
+        mCount = header->count;
+        for(uint32_t i = 0; i < mCount && valid; i++)
+        {
+            valid = mEntries[i].offset <= mSize && mEntries[i].size <= mSize - mEntries[i].offset && mEntries[i].name[PACK_NAME_LENGTH - 1] == '\0';
+        }
+    }
+    if(!valid)
+    {
+        printf("%s is not a valid asset archive!\n", path);
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void AssetPack::close()
+{
+#ifdef _WIN32
+    if(mBase != NULL)
+    {
+        UnmapViewOfFile(mBase);
+    }
+    if(mMapping != NULL)
+    {
+        CloseHandle(mMapping);
+        mMapping = NULL;
+    }
+    if(mFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(mFile);
+        mFile = INVALID_HANDLE_VALUE;
+    }
+#else
+    if(mBase != NULL)
+    {
+        munmap((void*)mBase, mSize);
+    }
+#endif
+    mBase = NULL;
+    mSize = 0;
+    mEntries = NULL;
+    mCount = 0;
+}
+
+bool AssetPack::isOpen() const
+{
+    return mBase != NULL;
+}
+
+const PackEntry* AssetPack::find(const char* name) const
+{
+    //A handful of entries, a linear scan is enough
+    for(uint32_t i = 0; i < mCount; i++)
+    {
+        if(strcmp(mEntries[i].name, name) == 0)
+        {
+            return &mEntries[i];
+        }
+    }
+    return NULL;
+}
+
+const void* AssetPack::data(const PackEntry* entry) const
+{
+    return mBase + entry->offset;
+}
+
+SDL_RWops* AssetPack::openRW(const PackEntry* entry) const
+{
+    return SDL_RWFromConstMem(data(entry), (int)entry->size);
+}
@@ -0,0 +1,105 @@
+//Packed asset archive, memory mapped so assets are used in place without decoding
+#ifndef ASSETPACK_H
+#define ASSETPACK_H
+
+#include <SDL.h>
+#include <stdint.h>
+
+//Archive layout, little endian:
+//  PackHeader
+//  PackEntry[count]
+//  asset data, each starting on a PACK_ALIGN boundary
+const char PACK_MAGIC[4] = { 'B', 'R', 'K', 'P' };
+const uint32_t PACK_VERSION = 1;
+const int PACK_NAME_LENGTH = 32;
+const int PACK_ALIGN = 16;
+
+//Archive built next to the executable by the packer
+const char PACK_FILE[] = "assets.pak";
+
+//Output format of the mixer; sounds are packed in it so they play straight from the mapping
+const int PACK_AUDIO_FREQUENCY = 44100;
+const SDL_AudioFormat PACK_AUDIO_FORMAT = AUDIO_S16SYS;
+const int PACK_AUDIO_CHANNELS = 2;
+
+//How the data of an entry is laid out
+enum PackType
+{
+    //Bytes of the original file, e.g. a font
+    PACK_RAW = 0,
+
+    //Pixels; params are width, height, pitch and SDL pixel format
+    PACK_IMAGE = 1,
+
+    //PCM samples; params are frequency, SDL audio format and channels
+    PACK_SOUND = 2
+};
+
+struct PackHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+struct PackEntry
+{
+    //Name of the source file, zero padded
+    char name[PACK_NAME_LENGTH];
+
+    uint32_t type;
+
+    //Position of the data from the start of the archive
+    uint32_t offset;
+    uint32_t size;
+
+    //Meaning depends on the type
+    uint32_t params[4];
+
+    uint32_t reserved;
+};
+
+//A read only mapping of an archive
+class AssetPack
+{
+    public:
+        //Initializes variables
+        AssetPack();
+
+        //Unmaps the archive
+        ~AssetPack();
+
+        //Maps an archive and checks its index
+        bool open(const char* path);
+
+        //Unmaps the archive; data handed out before becomes invalid
+        void close();
+
+        bool isOpen() const;
+
+        //Finds an entry by name, NULL when missing
+        const PackEntry* find(const char* name) const;
+
+        //Data of an entry, valid while the archive stays open
+        const void* data(const PackEntry* entry) const;
+
+        //Read only stream over an entry's data, for loaders that take an SDL_RWops
+        SDL_RWops* openRW(const PackEntry* entry) const;
+
+    private:
+        //Mapped file
+        const uint8_t* mBase;
+        size_t mSize;
+
+        //Index inside the mapping
+        const PackEntry* mEntries;
+        uint32_t mCount;
+
+#ifdef _WIN32
+        void* mFile;
+        void* mMapping;
+#endif
+};
+
+#endif
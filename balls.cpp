@@ -0,0 +1,189 @@
+//Multi-ball engine
+#include "balls.h"
+#include "contact.h"
+
+//Dots handed to a worker at a time
+const int BALL_GRAIN = 256;
+
+BallSystem::BallSystem()
+{
+    //Initialize
+    mBricks = NULL;
+    mPaddle.x = 0;
+    mPaddle.y = 0;
+}
+
+void BallSystem::clear()
+{
+    mX.clear();
+    mY.clear();
+    mVelX.clear();
+    mVelY.clear();
+}
+
+int BallSystem::add(const Ball& ball)
+{
+    mX.push_back(ball.x);
+    mY.push_back(ball.y);
+    mVelX.push_back(ball.velX);
+    mVelY.push_back(ball.velY);
+    return (int)mX.size() - 1;
+}
+
+int BallSystem::size() const
+{
+    return (int)mX.size();
+}
+
+Ball BallSystem::get(int index) const
+{
+    Ball b = { mX[index], mY[index], mVelX[index], mVelY[index] };
+    return b;
+}
+
+void BallSystem::setBricks(BrickStore* bricks)
+{
+    mBricks = bricks;
+}
+
+//A dot's view of the bricks during its sweep: the store stays untouched until every dot has moved,
+//but the bricks this dot already hit are gone for it, as they would be in the game
+struct StoreWalls
+{
+    const BrickStore& bricks;
+    int* hits;
+    int hitCount;
+
+    //Bricks looked at per sweep of the dot
+    static const int MAX_CANDIDATES = 256;
+
+    int query(const Rect& box, int* out, int maxOut) const
+    {
+        int count = bricks.query(box, out, maxOut);
+        int kept = 0;
+        for(int i = 0; i < count; i++)
+        {
+            if(!alreadyHit(out[i]))
+            {
+                out[kept++] = out[i];
+            }
+        }
+        return kept;
+    }
+
+    Rect rect(int brick) const
+    {
+        return bricks.rect(brick);
+    }
+
+    //Records the brick for destruction after the sweep
+    unsigned hit(int brick)
+    {
+        if(hitCount < MAX_BALL_HITS)
+        {
+            hits[hitCount++] = brick;
+        }
+        return EVENT_BREAK;
+    }
+
+    bool alreadyHit(int brick) const
+    {
+        for(int i = 0; i < hitCount; i++)
+        {
+            if(hits[i] == brick)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+void BallSystem::sweepBall(int index)
+{
+    Ball ball = get(index);
+    StoreWalls walls = { *mBricks, &mHits[index * MAX_BALL_HITS], 0 };
+    unsigned events = sweepDot(ball, mPaddle, walls);
+
+    mX[index] = ball.x;
+    mY[index] = ball.y;
+    mVelX[index] = ball.velX;
+    mVelY[index] = ball.velY;
+    mHitCount[index] = (unsigned char)walls.hitCount;
+    mBounced[index] = (events & EVENT_BOUNCE) != 0;
+}
+
+void BallSystem::sweepRange(void* context, int begin, int end)
+{
+    BallSystem* system = (BallSystem*)context;
+    for(int i = begin; i < end; i++)
+    {
+        system->sweepBall(i);
+    }
+}
+
+BallTick BallSystem::update(const Paddle& paddle, ThreadPool* pool)
+{
+    BallTick result = { 0, 0, 0 };
+    int count = size();
+    mPaddle = paddle;
+    mHits.resize(count * MAX_BALL_HITS);
+    mHitCount.resize(count);
+    mBounced.resize(count);
+
+    //Without bricks every dot only sees the edges and the paddle
+    BrickStore empty;
+    BrickStore* bricks = mBricks;
+    if(mBricks == NULL)
+    {
+        mBricks = &empty;
+    }
+
+    //Sweep every dot against the wall as it stands now
+    if(pool != NULL)
+    {
+        pool->parallelFor(count, BALL_GRAIN, sweepRange, this);
+    }
+    else
+    {
+        sweepRange(this, 0, count);
+    }
+
+    //Destroy the hit bricks in dot order, the first dot to reach a brick gets it
+    for(int i = 0; i < count; i++)
+    {
+        for(int k = 0; k < mHitCount[i]; k++)
+        {
+            int brick = mHits[i * MAX_BALL_HITS + k];
+            if(mBricks->alive(brick))
+            {
+                mBricks->destroy(brick);
+                result.bricksBroken++;
+            }
+        }
+        result.bounces += mBounced[i];
+    }
+
+    //Drop the dots that fell off the bottom, keeping the order of the rest
+    int kept = 0;
+    for(int i = 0; i < count; i++)
+    {
+        if(mY[i] + DOT_HEIGHT > SCREEN_HEIGHT)
+        {
+            result.ballsLost++;
+            continue;
+        }
+        mX[kept] = mX[i];
+        mY[kept] = mY[i];
+        mVelX[kept] = mVelX[i];
+        mVelY[kept] = mVelY[i];
+        kept++;
+    }
+    mX.resize(kept);
+    mY.resize(kept);
+    mVelX.resize(kept);
+    mVelY.resize(kept);
+
+    mBricks = bricks;
+    return result;
+}
@@ -0,0 +1,72 @@
+//Many dots at once, for stress runs; the benchmark drives it, the game itself plays one dot
+#ifndef BALLS_H
+#define BALLS_H
+
+#include <vector>
+#include "game.h"
+#include "bricks.h"
+#include "threadpool.h"
+
+//Bricks a single dot can break in one tick
+const int MAX_BALL_HITS = MAX_CONTACTS;
+
+//What happened during one multi-ball tick
+struct BallTick
+{
+    int bricksBroken;
+    int ballsLost;
+    int bounces;
+};
+
+//Dots kept as structure of arrays and swept against a brick store with the game's contact solver
+class BallSystem
+{
+    public:
+        //Initializes an empty system
+        BallSystem();
+
+        //Removes all dots
+        void clear();
+
+        //Adds a dot and returns its index
+        int add(const Ball& ball);
+
+        //Dot state
+        int size() const;
+        Ball get(int index) const;
+
+        //Sets the bricks the dots play against, looked up through the store's SIMD query.
+        //The store must outlive the system.
+        void setBricks(BrickStore* bricks);
+
+        //Advances every dot by one tick, sweeping the dots in parallel when a pool is given.
+        //Dots see the wall as it was at the start of the tick, and bricks are destroyed afterwards
+        //in dot order, so the outcome does not depend on the number of threads.
+        //Dots that fall off the bottom are removed, keeping the order of the rest.
+        BallTick update(const Paddle& paddle, ThreadPool* pool);
+
+        //Dot columns
+        const float* xs() const { return mX.empty() ? NULL : &mX[0]; }
+        const float* ys() const { return mY.empty() ? NULL : &mY[0]; }
+
+    private:
+        //Loop body for the thread pool
+        static void sweepRange(void* context, int begin, int end);
+
+        //Moves one dot through the tick, recording the bricks it hit
+        void sweepBall(int index);
+
+        //Dot columns
+        std::vector<float> mX, mY, mVelX, mVelY;
+
+        //Per dot results of the sweep: bricks hit and whether the paddle was
+        std::vector<int> mHits;
+        std::vector<unsigned char> mHitCount;
+        std::vector<unsigned char> mBounced;
+
+        //The bricks, and the paddle of the current tick
+        BrickStore* mBricks;
+        Paddle mPaddle;
+};
+
+#endif
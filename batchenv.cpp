@@ -0,0 +1,388 @@
+//Batch environment: structure of arrays games, a four wide free flight kernel and step() for everything else
+#include "batchenv.h"
+#include <vector>
+#include "board.h"
+#include "game.h"
+#include "softraster.h"
+#include "threadpool.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+//Games stepped per chunk handed to a thread
+const int BATCH_GRAIN = 1024;
+
+//Frames drawn per chunk handed to a thread
+const int RENDER_GRAIN = 16;
+
+//Free flight needs the whole move of the dot, grown by this many pixels, to stay clear of everything
+const float FREE_MARGIN = 1;
+
+//Bottom edge of the classic wall
+const int WALL_BOTTOM = ClassicBoard::rect(ClassicBoard::BRICKS - 1).y + ClassicBoard::rect(ClassicBoard::BRICKS - 1).h;
+
+struct BatchEnv
+{
+    int count;
+    uint32_t seed;
+    uint32_t maxTicks;
+
+    //Steps the chunks, NULL when stepping on the calling thread
+    ThreadPool* pool;
+
+    //Game state, one entry per game
+    std::vector<float> ballX, ballY, ballVelX, ballVelY;
+    std::vector<int32_t> paddleX;
+    std::vector<uint64_t> bricks;
+    std::vector<int32_t> lives, score, bricksLeft;
+    std::vector<uint32_t> tick;
+
+    //Results of the last step
+    std::vector<float> reward;
+    std::vector<uint8_t> done;
+
+    //Games started by each slot, so every episode gets its own seed
+    std::vector<uint32_t> episodes;
+
+    //The paddle never leaves its row
+    int paddleY;
+
+    //Actions of the step in progress
+    const int8_t* actions;
+
+    //Draws the pixel observations, NULL until first needed
+    SoftRaster* raster;
+
+    //Frames of the render in progress
+    uint8_t* pixels;
+};
+
+//Seed of an episode of a game
+static uint32_t episodeSeed(const BatchEnv& env, int index)
+{
+    return env.seed * 0x9E3779B1u ^ (uint32_t)index * 0x85EBCA77u ^ env.episodes[index] * 0xC2B2AE3Du;
+}
+
+//Copies a game between the arrays and a GameState
+static void loadGame(const BatchEnv& env, int i, GameState& state)
+{
+    state.ball.x = env.ballX[i];
+    state.ball.y = env.ballY[i];
+    state.ball.velX = env.ballVelX[i];
+    state.ball.velY = env.ballVelY[i];
+    state.paddle.x = env.paddleX[i];
+    state.paddle.y = env.paddleY;
+    state.bricks = env.bricks[i];
+    state.lives = env.lives[i];
+    state.score = env.score[i];
+    state.bricksLeft = env.bricksLeft[i];
+    state.winScore = WIN_SCORE;
+    state.tick = env.tick[i];
+}
+
+static void storeGame(BatchEnv& env, int i, const GameState& state)
+{
+    env.ballX[i] = state.ball.x;
+    env.ballY[i] = state.ball.y;
+    env.ballVelX[i] = state.ball.velX;
+    env.ballVelY[i] = state.ball.velY;
+    env.paddleX[i] = state.paddle.x;
+    env.bricks[i] = state.bricks;
+    env.lives[i] = state.lives;
+    env.score[i] = state.score;
+    env.bricksLeft[i] = state.bricksLeft;
+    env.tick[i] = state.tick;
+}
+
+//Starts the next episode of a game
+static void resetGame(BatchEnv& env, int i)
+{
+    GameState state;
+    initGame(state, episodeSeed(env, i));
+    storeGame(env, i, state);
+    env.episodes[i]++;
+}
+
+//Whether the dot moving from (x, y) to (nextX, nextY) can't touch an edge, the paddle, the wall or the bottom,
+//so step() would only add the velocity. The same test as the four wide kernel.
+static bool freeFlight(float x, float y, float nextX, float nextY, int paddleX, int paddleY)
+{
+    float left = x < nextX ? x : nextX;
+    float right = x < nextX ? nextX : x;
+    float top = y < nextY ? y : nextY;
+    float bottom = y < nextY ? nextY : y;
+
+    bool clear = left >= FREE_MARGIN && right + DOT_WIDTH + FREE_MARGIN <= SCREEN_WIDTH
+              && top >= WALL_BOTTOM + FREE_MARGIN + 1 && bottom + DOT_HEIGHT + FREE_MARGIN <= SCREEN_HEIGHT;
+    bool missesPaddle = bottom + DOT_HEIGHT + FREE_MARGIN < paddleY
+                     || right + DOT_WIDTH + FREE_MARGIN < paddleX
+                     || left - FREE_MARGIN > paddleX + PADDLE_WIDTH;
+    return clear && missesPaddle;
+}
+
+//Ends a step of a game: flags a finished game and starts it again
+static void finishGame(BatchEnv& env, int i, bool over)
+{
+    bool done = over || (env.maxTicks != 0 && env.tick[i] >= env.maxTicks);
+    env.done[i] = done;
+    if(done)
+    {
+        resetGame(env, i);
+    }
+}
+
+//A tick of a game that moves in free flight
+static void stepFree(BatchEnv& env, int i)
+{
+    env.tick[i]++;
+    env.reward[i] = 0;
+    finishGame(env, i, false);
+}
+
+//A tick of a game through step(), the paddle having moved already
+static void stepFull(BatchEnv& env, int i)
+{
+    GameState state;
+    loadGame(env, i, state);
+    GameInput input = { 0 };
+    step(state, input);
+
+    env.reward[i] = (float)(state.score - env.score[i]);
+    storeGame(env, i, state);
+    finishGame(env, i, gameOver(state) || gameWon(state));
+}
+
+//Steps the games [begin, end)
+static void stepRange(void* context, int begin, int end)
+{
+    BatchEnv& env = *(BatchEnv*)context;
+
+    //Move the paddles before the dots, as step() does
+    for(int i = begin; i < end; i++)
+    {
+        int dir = env.actions[i] < 0 ? -1 : env.actions[i] > 0 ? 1 : 0;
+        int x = env.paddleX[i] + dir * PADDLE_VEL;
+        if(x >= 0 && x + PADDLE_WIDTH <= SCREEN_WIDTH)
+        {
+            env.paddleX[i] = x;
+        }
+    }
+
+    int i = begin;
+#if defined(__SSE2__)
+    //Four dots at a time: those in free flight add their velocity, the rest go through step()
+    const __m128 minLeft = _mm_set1_ps(FREE_MARGIN);
+    const __m128 maxRight = _mm_set1_ps(SCREEN_WIDTH - DOT_WIDTH - FREE_MARGIN);
+    const __m128 minTop = _mm_set1_ps(WALL_BOTTOM + FREE_MARGIN + 1);
+    const __m128 maxBottom = _mm_set1_ps(SCREEN_HEIGHT - DOT_HEIGHT - FREE_MARGIN);
+    const __m128 paddleTop = _mm_set1_ps(env.paddleY - DOT_HEIGHT - FREE_MARGIN);
+    for(; i + 4 <= end; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(&env.ballX[i]);
+        __m128 y = _mm_loadu_ps(&env.ballY[i]);
+        __m128 nextX = _mm_add_ps(x, _mm_loadu_ps(&env.ballVelX[i]));
+        __m128 nextY = _mm_add_ps(y, _mm_loadu_ps(&env.ballVelY[i]));
+        __m128 left = _mm_min_ps(x, nextX);
+        __m128 right = _mm_max_ps(x, nextX);
+        __m128 top = _mm_min_ps(y, nextY);
+        __m128 bottom = _mm_max_ps(y, nextY);
+        __m128 paddle = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)&env.paddleX[i]));
+
+        __m128 clear = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(left, minLeft), _mm_cmple_ps(right, maxRight)),
+                                  _mm_and_ps(_mm_cmpge_ps(top, minTop), _mm_cmple_ps(bottom, maxBottom)));
+        __m128 missesPaddle = _mm_or_ps(_mm_cmplt_ps(bottom, paddleTop),
+                                        _mm_or_ps(_mm_cmplt_ps(_mm_add_ps(right, _mm_set1_ps(DOT_WIDTH + FREE_MARGIN)), paddle),
+                                                  _mm_cmpgt_ps(_mm_sub_ps(left, _mm_set1_ps(FREE_MARGIN)), _mm_add_ps(paddle, _mm_set1_ps(PADDLE_WIDTH)))));
+        __m128 free = _mm_and_ps(clear, missesPaddle);
+
+        _mm_storeu_ps(&env.ballX[i], _mm_or_ps(_mm_and_ps(free, nextX), _mm_andnot_ps(free, x)));
+        _mm_storeu_ps(&env.ballY[i], _mm_or_ps(_mm_and_ps(free, nextY), _mm_andnot_ps(free, y)));
+
+        int mask = _mm_movemask_ps(free);
+        for(int lane = 0; lane < 4; lane++)
+        {
+            if(mask & (1 << lane))
+            {
+                stepFree(env, i + lane);
+            }
+            else
+            {
+                stepFull(env, i + lane);
+            }
+        }
+    }
+#endif
+
+    //The rest one at a time
+    for(; i < end; i++)
+    {
+        float nextX = env.ballX[i] + env.ballVelX[i];
+        float nextY = env.ballY[i] + env.ballVelY[i];
+        if(freeFlight(env.ballX[i], env.ballY[i], nextX, nextY, env.paddleX[i], env.paddleY))
+        {
+            env.ballX[i] = nextX;
+            env.ballY[i] = nextY;
+            stepFree(env, i);
+        }
+        else
+        {
+            stepFull(env, i);
+        }
+    }
+}
+
+//Draws the games [begin, end) into their frames
+static void renderRange(void* context, int begin, int end)
+{
+    BatchEnv& env = *(BatchEnv*)context;
+    const SoftRaster& raster = *env.raster;
+    int frameBytes = raster.pitch() * raster.height();
+    for(int i = begin; i < end; i++)
+    {
+        GameState state;
+        loadGame(env, i, state);
+        raster.renderInto(env.pixels + (size_t)frameBytes * i, raster.pitch(), state);
+    }
+}
+
+BatchEnv* batchEnvCreate(int count, uint32_t seed, uint32_t maxTicks, int threads)
+{
+    if(count <= 0)
+    {
+        return NULL;
+    }
+
+    BatchEnv* env = new BatchEnv;
+    env->count = count;
+    env->seed = seed;
+    env->maxTicks = maxTicks;
+    env->pool = threads == 1 ? NULL : new ThreadPool(threads);
+    env->actions = NULL;
+    env->raster = NULL;
+    env->pixels = NULL;
+
+    env->ballX.resize(count);
+    env->ballY.resize(count);
+    env->ballVelX.resize(count);
+    env->ballVelY.resize(count);
+    env->paddleX.resize(count);
+    env->bricks.resize(count);
+    env->lives.resize(count);
+    env->score.resize(count);
+    env->bricksLeft.resize(count);
+    env->tick.resize(count);
+    env->reward.resize(count);
+    env->done.resize(count);
+    env->episodes.resize(count);
+
+    GameState fresh;
+    initGame(fresh);
+    env->paddleY = fresh.paddle.y;
+
+    batchEnvReset(env);
+    return env;
+}
+
+void batchEnvDestroy(BatchEnv* env)
+{
+    if(env != NULL)
+    {
+        delete env->pool;
+        delete env->raster;
+        delete env;
+    }
+}
+
+void batchEnvReset(BatchEnv* env)
+{
+    for(int i = 0; i < env->count; i++)
+    {
+        env->episodes[i] = 0;
+        resetGame(*env, i);
+        env->reward[i] = 0;
+        env->done[i] = 0;
+    }
+}
+
+void batchEnvStep(BatchEnv* env, const int8_t* actions)
+{
+    env->actions = actions;
+    if(env->pool != NULL)
+    {
+        env->pool->parallelFor(env->count, BATCH_GRAIN, stepRange, env);
+    }
+    else
+    {
+        stepRange(env, 0, env->count);
+    }
+    env->actions = NULL;
+}
+
+int batchEnvCount(const BatchEnv* env)
+{
+    return env->count;
+}
+
+BatchBuffers batchEnvBuffers(const BatchEnv* env)
+{
+    BatchBuffers buffers;
+    buffers.ballX = &env->ballX[0];
+    buffers.ballY = &env->ballY[0];
+    buffers.ballVelX = &env->ballVelX[0];
+    buffers.ballVelY = &env->ballVelY[0];
+    buffers.paddleX = &env->paddleX[0];
+    buffers.bricks = &env->bricks[0];
+    buffers.lives = &env->lives[0];
+    buffers.score = &env->score[0];
+    buffers.tick = &env->tick[0];
+    buffers.reward = &env->reward[0];
+    buffers.done = &env->done[0];
+    return buffers;
+}
+
+int batchEnvSetRender(BatchEnv* env, int scale, int gray, const char* sprite, int* width, int* height)
+{
+    if(env->raster == NULL)
+    {
+        env->raster = new SoftRaster;
+    }
+    SoftRaster& raster = *env->raster;
+    if(!raster.init(scale, gray ? SOFT_GRAY : SOFT_RGBA))
+    {
+        return 0;
+    }
+    if(sprite != NULL && !raster.loadSprite(sprite))
+    {
+        return 0;
+    }
+
+    if(width != NULL)
+    {
+        *width = raster.width();
+    }
+    if(height != NULL)
+    {
+        *height = raster.height();
+    }
+    return raster.pitch() * raster.height();
+}
+
+void batchEnvRender(BatchEnv* env, uint8_t* pixels)
+{
+    if(env->raster == NULL)
+    {
+        batchEnvSetRender(env, 1, 0, NULL, NULL, NULL);
+    }
+
+    env->pixels = pixels;
+    if(env->pool != NULL)
+    {
+        env->pool->parallelFor(env->count, RENDER_GRAIN, renderRange, env);
+    }
+    else
+    {
+        renderRange(env, 0, env->count);
+    }
+    env->pixels = NULL;
+}
@@ -0,0 +1,66 @@
+//Many classic games stepped in lockstep for training paddle agents, with a C interface.
+//Every step gives exactly the result of step() on each game: dots in free flight move four at a time,
+//ticks with a contact go through step() itself.
+#ifndef BATCHENV_H
+#define BATCHENV_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct BatchEnv BatchEnv;
+
+//Per game buffers, each count entries long and valid until the environment is destroyed.
+//After a step they hold the state each game is in now; a game that finished was reset already,
+//its done flag is set and its reward is that of the final step.
+typedef struct BatchBuffers
+{
+    //Observations
+    const float* ballX;
+    const float* ballY;
+    const float* ballVelX;
+    const float* ballVelY;
+    const int32_t* paddleX;
+    const uint64_t* bricks;
+    const int32_t* lives;
+    const int32_t* score;
+    const uint32_t* tick;
+
+    //Points scored by the last step
+    const float* reward;
+
+    //Set when the last step lost the last life, cleared the wall or reached the tick limit
+    const uint8_t* done;
+} BatchBuffers;
+
+//Creates count games, started from seeds derived from seed.
+//Games end after maxTicks ticks, 0 for no limit; threads 0 uses every core, 1 steps on the calling thread.
+//Returns NULL if count is not positive.
+BatchEnv* batchEnvCreate(int count, uint32_t seed, uint32_t maxTicks, int threads);
+
+void batchEnvDestroy(BatchEnv* env);
+
+//Restarts every game
+void batchEnvReset(BatchEnv* env);
+
+//Advances every game by one tick. actions holds one paddle move per game: -1 left, 0 stay, 1 right.
+void batchEnvStep(BatchEnv* env, const int8_t* actions);
+
+int batchEnvCount(const BatchEnv* env);
+BatchBuffers batchEnvBuffers(const BatchEnv* env);
+
+//Sets up pixel observations: the screen divided by scale, four bytes R G B A per pixel or one byte of luminance when gray is set.
+//sprite is a BMP drawn for the dot, NULL for a black box. Writes the frame size and returns the bytes of one frame, 0 on failure.
+int batchEnvSetRender(BatchEnv* env, int scale, int gray, const char* sprite, int* width, int* height);
+
+//Draws every game as the screen shows it, without labels, into count frames laid one after another.
+//Uses full size RGBA frames if batchEnvSetRender was never called.
+void batchEnvRender(BatchEnv* env, uint8_t* pixels);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
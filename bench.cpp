@@ -0,0 +1,896 @@
+//Benchmarks for the collision, rollback, wall, text, frame, particle and software raster paths, written out as JSON.
+//Rendering runs on the software renderer of a headless video driver, offscreen or dummy, so it works on a headless box.
+#include <SDL.h>
+#include <SDL_image.h>
+#include <SDL_ttf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "game.h"
+#include "bricks.h"
+#include "balls.h"
+#include "batchenv.h"
+#include "board.h"
+#include "glyphatlas.h"
+#include "headless.h"
+#include "layers.h"
+#include "level.h"
+#include "ltexture.h"
+#include "particles.h"
+#include "rollback.h"
+#include "softraster.h"
+#include "wallbatch.h"
+
+using namespace std;
+
+//The window and renderer the texture wrapper draws with
+SDL_Window* gWindow = NULL;
+SDL_Renderer* gRenderer = NULL;
+
+//Globally used font
+TTF_Font* gFont = NULL;
+
+//One measured benchmark
+struct BenchResult
+{
+    string group;
+    string name;
+    long long iterations;
+    double nsPerOp;
+};
+
+//Results in the order they ran
+vector<BenchResult> gResults;
+
+//Time spent measuring each benchmark, after a warm up run
+double gMinSeconds = 0.25;
+
+//Where the JSON goes, stdout when NULL
+const char* gOutPath = NULL;
+
+//Video driver used for the rendering benchmarks, picked from the ones SDL has when NULL
+const char* gVideoDriver = NULL;
+
+//Only benchmarks whose group or name contains this run, all when NULL
+const char* gFilter = NULL;
+
+//Longest the particles of a frame may take to draw, a frame at 60 Hz
+const double PARTICLE_FRAME_BUDGET_NS = 1e9 / 60;
+
+//Set when a benchmark held to a budget went over it
+bool gOverBudget = false;
+
+//Keeps the compiler from dropping work whose result is unused
+volatile uint64_t gSink = 0;
+
+//Runs body(n) with n doubling until it takes at least gMinSeconds, then records the time per operation
+template<class Body>
+void runBench(const char* group, const char* name, Body body)
+{
+    if(gFilter != NULL && strstr(group, gFilter) == NULL && strstr(name, gFilter) == NULL)
+    {
+        return;
+    }
+
+    //Warm up caches and lazily created resources
+    body(1);
+
+    long long iterations = 1;
+    double seconds = 0;
+    for(;;)
+    {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        body(iterations);
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if(seconds >= gMinSeconds || iterations >= (1LL << 40))
+        {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    BenchResult result = { group, name, iterations, seconds * 1e9 / iterations };
+    gResults.push_back(result);
+    fprintf(stderr, "%-10s %-32s %14.1f ns/op\n", group, name, result.nsPerOp);
+}
+
+//Random box within the screen, for collision queries
+static Rect randomBox(int w, int h)
+{
+    Rect r = { rand() % (SCREEN_WIDTH - w), rand() % (SCREEN_HEIGHT - h), w, h };
+    return r;
+}
+
+//Input that keeps the paddle under the dot, so games last
+static GameInput followBall(const GameState& state)
+{
+    GameInput input = { 0 };
+    int target = (int)state.ball.x + DOT_WIDTH / 2 - PADDLE_WIDTH / 2;
+    if(state.paddle.x < target - PADDLE_VEL / 2)
+    {
+        input.paddleMove = 1;
+    }
+    else if(state.paddle.x > target + PADDLE_VEL / 2)
+    {
+        input.paddleMove = -1;
+    }
+    return input;
+}
+
+//A game halfway through, so the wall has gaps
+static GameState midGame()
+{
+    GameState state;
+    initGame(state);
+    while(state.bricksLeft > BRICK_NUMBER / 2 && !gameOver(state))
+    {
+        step(state, followBall(state));
+    }
+    return state;
+}
+
+void benchCollision()
+{
+    //Boxes the size of the dot, reused round robin
+    const int BOXES = 1024;
+    Rect boxes[BOXES], others[BOXES];
+    for(int i = 0; i < BOXES; i++)
+    {
+        boxes[i] = randomBox(DOT_WIDTH, DOT_HEIGHT);
+        others[i] = randomBox(SCREEN_WIDTH / 11, 10);
+    }
+
+    runBench("collision", "checkCollision", [&](long long n)
+    {
+        uint64_t hits = 0;
+        for(long long i = 0; i < n; i++)
+        {
+            hits += checkCollision(boxes[i & (BOXES - 1)], others[(i * 7) & (BOXES - 1)]);
+        }
+        gSink += hits;
+    });
+
+    //The brick lookup that replaced the full scan in handleCollision
+    GameState state = midGame();
+    runBench("collision", "queryGrid/classic", [&](long long n)
+    {
+        int hits[BRICK_NUMBER];
+        uint64_t found = 0;
+        for(long long i = 0; i < n; i++)
+        {
+            found += queryGrid(CLASSIC_GRID, &state.bricks, boxes[i & (BOXES - 1)], hits, BRICK_NUMBER);
+        }
+        gSink += found;
+    });
+
+    //The same wall as a compile time board, which the simulation uses
+    runBench("collision", "ClassicBoard::query", [&](long long n)
+    {
+        int hits[BRICK_NUMBER];
+        uint64_t found = 0;
+        for(long long i = 0; i < n; i++)
+        {
+            found += ClassicBoard::query(&state.bricks, boxes[i & (BOXES - 1)], hits, BRICK_NUMBER);
+        }
+        gSink += found;
+    });
+
+    //The same lookup on a wall thousands of rows tall
+    BrickGrid tall = CLASSIC_GRID;
+    tall.rows = 4096;
+    vector<uint64_t> tallAlive((tall.rows * tall.cols + 63) / 64, ~(uint64_t)0);
+    runBench("collision", "queryGrid/4096rows", [&](long long n)
+    {
+        int hits[BRICK_NUMBER];
+        uint64_t found = 0;
+        for(long long i = 0; i < n; i++)
+        {
+            Rect box = boxes[i & (BOXES - 1)];
+            box.y += (int)(i % tall.rows) * tall.pitchY;
+            found += queryGrid(tall, &tallAlive[0], box, hits, BRICK_NUMBER);
+        }
+        gSink += found;
+    });
+
+    runBench("collision", "sweepBox", [&](long long n)
+    {
+        uint64_t found = 0;
+        float time;
+        int normalX, normalY;
+        for(long long i = 0; i < n; i++)
+        {
+            const Rect& a = boxes[i & (BOXES - 1)];
+            found += sweepBox((float)a.x, (float)a.y, DOT_WIDTH, DOT_HEIGHT, 7.5f, -9.25f, others[(i * 7) & (BOXES - 1)], time, normalX, normalY);
+        }
+        gSink += found;
+    });
+
+    //Brute force against a scattered layout through the SIMD kernel
+    BrickStore store;
+    for(int i = 0; i < 4096; i++)
+    {
+        store.add(randomBox(SCREEN_WIDTH / 11, 10));
+    }
+    vector<uint64_t> mask((store.size() + 63) / 64);
+    runBench("collision", "BrickStore::overlap/4096", [&](long long n)
+    {
+        uint64_t found = 0;
+        for(long long i = 0; i < n; i++)
+        {
+            found += store.overlap(boxes[i & (BOXES - 1)], &mask[0]);
+        }
+        gSink += found;
+    });
+
+    //A whole tick of the game
+    GameState game;
+    initGame(game);
+    runBench("collision", "step", [&](long long n)
+    {
+        for(long long i = 0; i < n; i++)
+        {
+            if(gameOver(game) || gameWon(game))
+            {
+                initGame(game);
+            }
+            gSink += step(game, followBall(game));
+        }
+    });
+
+    //Ten thousand dots on the classic wall, one tick
+    BrickStore wall;
+    BallSystem balls;
+    Paddle paddle = { (SCREEN_WIDTH - PADDLE_WIDTH) / 2, 580 };
+    runBench("collision", "BallSystem::update/10k", [&](long long n)
+    {
+        for(long long i = 0; i < n; i++)
+        {
+            if(balls.size() < 5000)
+            {
+                //Refill the wall and the dots once half of them are gone
+                wall.clear();
+                wall.addGrid(CLASSIC_GRID);
+                balls.setBricks(&wall);
+                balls.clear();
+                for(int b = 0; b < 10000; b++)
+                {
+                    Ball ball = { (float)(rand() % (SCREEN_WIDTH - DOT_WIDTH)), (float)(150 + rand() % 300), (rand() % 200 - 100) / 20.0f, (rand() % 200 - 100) / 20.0f };
+                    balls.add(ball);
+                }
+            }
+            gSink += balls.update(paddle, NULL).bricksBroken;
+        }
+    });
+}
+
+//Steps of 65536 games in lockstep, on the calling thread and on every core, with paddles following their dots
+void benchBatch()
+{
+    const int GAMES = 65536;
+    vector<int8_t> actions(GAMES);
+    static const struct { const char* name; int threads; } RUNS[] = { { "batchEnvStep/64k/1thread", 1 }, { "batchEnvStep/64k/allcores", 0 } };
+    for(size_t run = 0; run < sizeof(RUNS) / sizeof(RUNS[0]); run++)
+    {
+        BatchEnv* env = batchEnvCreate(GAMES, 1, 0, RUNS[run].threads);
+        runBench("batch", RUNS[run].name, [&](long long n)
+        {
+            for(long long i = 0; i < n; i++)
+            {
+                BatchBuffers buffers = batchEnvBuffers(env);
+                for(int g = 0; g < GAMES; g++)
+                {
+                    int target = (int)buffers.ballX[g] + DOT_WIDTH / 2 - PADDLE_WIDTH / 2;
+                    actions[g] = buffers.paddleX[g] < target - PADDLE_VEL / 2 ? 1 : buffers.paddleX[g] > target + PADDLE_VEL / 2 ? -1 : 0;
+                }
+                batchEnvStep(env, &actions[0]);
+            }
+            gSink += batchEnvBuffers(env).score[0];
+        });
+        batchEnvDestroy(env);
+    }
+}
+
+//Save states and what a rollback costs: restoring one and simulating the ticks since again
+void benchRollback()
+{
+    VersusState versus;
+    initVersus(versus, 1);
+    int8_t inputs[VERSUS_PLAYERS] = { 0, 0 };
+    while(versus.players[0].bricksLeft > BRICK_NUMBER / 2 && !versusOver(versus))
+    {
+        inputs[0] = (int8_t)followBall(versus.players[0]).paddleMove;
+        inputs[1] = (int8_t)followBall(versus.players[1]).paddleMove;
+        stepVersus(versus, inputs);
+    }
+
+    //Round trips through a ring of slots, like a session's history
+    GameState game = versus.players[0];
+    static GameState gameSlots[ROLLBACK_HISTORY];
+    runBench("rollback", "saveLoad/game", [&](long long n)
+    {
+        for(long long i = 0; i < n; i++)
+        {
+            gameSlots[i % ROLLBACK_HISTORY] = game;
+            game = gameSlots[(i * 7) % ROLLBACK_HISTORY];
+        }
+        gSink += game.tick;
+    });
+
+    static VersusState versusSlots[ROLLBACK_HISTORY];
+    runBench("rollback", "saveLoad/versus", [&](long long n)
+    {
+        for(long long i = 0; i < n; i++)
+        {
+            versusSlots[i % ROLLBACK_HISTORY] = versus;
+            versus = versusSlots[(i * 7) % ROLLBACK_HISTORY];
+        }
+        gSink += versus.tick;
+    });
+
+    static const struct { const char* name; int depth; } DEPTHS[] = { { "resimulate/1tick", 1 }, { "resimulate/8ticks", 8 } };
+    for(size_t d = 0; d < sizeof(DEPTHS) / sizeof(DEPTHS[0]); d++)
+    {
+        runBench("rollback", DEPTHS[d].name, [&](long long n)
+        {
+            VersusState state;
+            for(long long i = 0; i < n; i++)
+            {
+                state = versus;
+                for(int t = 0; t < DEPTHS[d].depth; t++)
+                {
+                    inputs[0] = (int8_t)((i + t) % 3 - 1);
+                    stepVersus(state, inputs);
+                }
+                gSink += state.tick;
+            }
+        });
+    }
+}
+
+//A generated level of 400 by 250 two pixel bricks, written in both forms
+static bool makeBigLevel(Level& level, const char* binaryPath, const char* textPath)
+{
+    FILE* text = fopen(textPath, "w");
+    if(text == NULL)
+    {
+        printf("Unable to create %s!\n", textPath);
+        return false;
+    }
+
+    level.clear();
+    fprintf(text, "win 0\n");
+    for(int row = 0; row < 250; row++)
+    {
+        for(int col = 0; col < 400; col++)
+        {
+            Rect r = { col, 40 + row * 2, 2, 2 };
+            int hits = row % 3 + 1;
+            uint32_t color = ((uint32_t)(row * 255 / 250) << 24) | ((uint32_t)(col * 255 / 400) << 16) | 0x80FF;
+            level.add(r, hits, 1, color);
+            fprintf(text, "brick %d %d %d %d %d %d %08X\n", r.x, r.y, r.w, r.h, hits, 1, color);
+        }
+    }
+    level.build();
+
+    bool success = ferror(text) == 0;
+    fclose(text);
+    return success && level.save(binaryPath);
+}
+
+void benchLevel()
+{
+    const char* BINARY_PATH = "bench-level.lvl";
+    const char* TEXT_PATH = "bench-level.txt";
+
+    Level big;
+    if(!makeBigLevel(big, BINARY_PATH, TEXT_PATH))
+    {
+        printf("Failed to write the generated level, skipping level benchmarks!\n");
+        return;
+    }
+
+    //Loading 100k bricks: compiled from a file, compiled from memory as a mapped archive hands it over, and parsed
+    runBench("level", "load/binary/100k", [&](long long n)
+    {
+        for(long long i = 0; i < n; i++)
+        {
+            Level level;
+            gSink += level.load(BINARY_PATH) ? level.size() : 0;
+        }
+    });
+
+    vector<char> compiled;
+    FILE* file = fopen(BINARY_PATH, "rb");
+    if(file != NULL)
+    {
+        char buffer[65536];
+        size_t read;
+        while((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        {
+            compiled.insert(compiled.end(), buffer, buffer + read);
+        }
+        fclose(file);
+    }
+    runBench("level", "load/memory/100k", [&](long long n)
+    {
+        for(long long i = 0; i < n; i++)
+        {
+            Level level;
+            gSink += level.load(&compiled[0], compiled.size()) ? level.size() : 0;
+        }
+    });
+
+    runBench("level", "load/text/100k", [&](long long n)
+    {
+        for(long long i = 0; i < n; i++)
+        {
+            Level level;
+            gSink += level.loadText(TEXT_PATH) ? level.size() : 0;
+        }
+    });
+
+    //Dot sized queries and whole ticks against the dense level
+    LevelState state;
+    GameState game;
+    initGame(game, state, big);
+    runBench("level", "Level::query/100k", [&](long long n)
+    {
+        int hits[LEVEL_MAX_CANDIDATES];
+        for(long long i = 0; i < n; i++)
+        {
+            gSink += big.query(state.alive.data(), randomBox(DOT_WIDTH, DOT_HEIGHT), hits, LEVEL_MAX_CANDIDATES);
+        }
+    });
+
+    runBench("level", "step/100k", [&](long long n)
+    {
+        for(long long i = 0; i < n; i++)
+        {
+            if(gameOver(game) || gameWon(game))
+            {
+                initGame(game, state, big);
+            }
+            gSink += step(game, state, followBall(game));
+        }
+    });
+
+    remove(BINARY_PATH);
+    remove(TEXT_PATH);
+}
+
+//Makes the renderer carry out the draws queued so far, so they are timed.
+//Reading a pixel back does that on every SDL version; SDL_RenderFlush only exists from 2.0.10 on.
+static void flushRenderer()
+{
+    Uint32 pixel;
+    SDL_Rect one = { 0, 0, 1, 1 };
+    SDL_RenderReadPixels(gRenderer, &one, SDL_PIXELFORMAT_ARGB8888, &pixel, sizeof(pixel));
+}
+
+//The wall drawn one brick at a time, the way updateWall used to
+static void drawWallDirect(const GameState& state)
+{
+    static const Uint8 colors[ROWS][3] = { { 255, 0, 0 }, { 255, 144, 0 }, { 0, 128, 0 }, { 255, 255, 0 }, { 0, 0, 255 } };
+    for(int row = 0; row < ROWS; row++)
+    {
+        for(int col = 0; col < COLS; col++)
+        {
+            if(brickAlive(state, row, col))
+            {
+                Rect r = brickRect(row, col);
+                SDL_Rect fillRect = { r.x, r.y, r.w, r.h };
+                SDL_SetRenderDrawColor(gRenderer, colors[row][0], colors[row][1], colors[row][2], 255);
+                SDL_RenderFillRect(gRenderer, &fillRect);
+            }
+        }
+    }
+}
+
+void benchWall()
+{
+    GameState state = midGame();
+    WallBatch batch;
+
+    runBench("wall", "direct", [&](long long n)
+    {
+        for(long long i = 0; i < n; i++)
+        {
+            drawWallDirect(state);
+            flushRenderer();
+        }
+    });
+
+    runBench("wall", "batch/rebuild", [&](long long n)
+    {
+        for(long long i = 0; i < n; i++)
+        {
+            batch.invalidate();
+            batch.update(state);
+            batch.render(gRenderer);
+            flushRenderer();
+        }
+    });
+
+    runBench("wall", "batch/cached", [&](long long n)
+    {
+        for(long long i = 0; i < n; i++)
+        {
+            batch.update(state);
+            batch.render(gRenderer);
+            flushRenderer();
+        }
+    });
+
+    RenderLayer layer;
+    if(layer.create(gRenderer, SCREEN_WIDTH, SCREEN_HEIGHT, false))
+    {
+        if(layer.begin(gRenderer))
+        {
+            batch.render(gRenderer);
+            layer.end(gRenderer);
+        }
+        runBench("wall", "layer/composite", [&](long long n)
+        {
+            for(long long i = 0; i < n; i++)
+            {
+                layer.render(gRenderer);
+                flushRenderer();
+            }
+        });
+    }
+}
+
+void benchText(GlyphAtlas& atlas)
+{
+    SDL_Color black = { 0, 0, 0, 0xFF };
+    LTexture texture;
+
+    //What every brick hit used to cost
+    runBench("text", "LTexture::loadFromRenderedText", [&](long long n)
+    {
+        for(long long i = 0; i < n; i++)
+        {
+            texture.loadFromRenderedText(i & 1 ? "Score:123" : "Score:124", black);
+        }
+    });
+
+    runBench("text", "GlyphAtlas::render", [&](long long n)
+    {
+        char label[32];
+        for(long long i = 0; i < n; i++)
+        {
+            snprintf(label, sizeof(label), "Score:%d", (int)(i % 150));
+            atlas.render(gRenderer, 5, 5, label, black);
+            flushRenderer();
+        }
+    });
+}
+
+void benchFrames(GlyphAtlas& atlas, LTexture& dot)
+{
+    SDL_Color black = { 0, 0, 0, 0xFF };
+
+    //A game frame drawn from scratch every time
+    GameState game;
+    initGame(game);
+    WallBatch batch;
+    runBench("frame", "direct", [&](long long n)
+    {
+        for(long long i = 0; i < n; i++)
+        {
+            if(gameOver(game) || gameWon(game))
+            {
+                initGame(game);
+            }
+            step(game, followBall(game));
+
+            SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
+            SDL_RenderClear(gRenderer);
+            batch.update(game);
+            batch.render(gRenderer);
+            SDL_Rect paddle = { game.paddle.x, game.paddle.y, PADDLE_WIDTH, PADDLE_HEIGHT };
+            SDL_SetRenderDrawColor(gRenderer, 0, 0, 0, 0xFF);
+            SDL_RenderFillRect(gRenderer, &paddle);
+            dot.render((int)game.ball.x, (int)game.ball.y);
+            atlas.render(gRenderer, 5, 5, "Score:0", black);
+            atlas.render(gRenderer, 320, 5, "Lives:3", black);
+            atlas.render(gRenderer, 5, (SCREEN_HEIGHT / 2) + 20, "Hit UP to start/pause/resume/quit", black);
+            SDL_RenderPresent(gRenderer);
+        }
+    });
+
+    //The same frame composited from cached layers
+    RenderLayer wallLayer, hudLayer;
+    if(wallLayer.create(gRenderer, SCREEN_WIDTH, SCREEN_HEIGHT, false) && hudLayer.create(gRenderer, SCREEN_WIDTH, SCREEN_HEIGHT, true))
+    {
+        initGame(game);
+        uint64_t layerBricks = 0;
+        runBench("frame", "layered", [&](long long n)
+        {
+            for(long long i = 0; i < n; i++)
+            {
+                if(gameOver(game) || gameWon(game))
+                {
+                    initGame(game);
+                }
+                step(game, followBall(game));
+
+                if(game.bricks != layerBricks)
+                {
+                    wallLayer.invalidate();
+                    layerBricks = game.bricks;
+                }
+                if(wallLayer.begin(gRenderer))
+                {
+                    batch.update(game);
+                    batch.render(gRenderer);
+                    wallLayer.end(gRenderer);
+                }
+                if(hudLayer.begin(gRenderer))
+                {
+                    atlas.render(gRenderer, 5, 5, "Score:0", black);
+                    atlas.render(gRenderer, 320, 5, "Lives:3", black);
+                    atlas.render(gRenderer, 5, (SCREEN_HEIGHT / 2) + 20, "Hit UP to start/pause/resume/quit", black);
+                    hudLayer.end(gRenderer);
+                }
+
+                wallLayer.render(gRenderer);
+                SDL_Rect paddle = { game.paddle.x, game.paddle.y, PADDLE_WIDTH, PADDLE_HEIGHT };
+                SDL_SetRenderDrawColor(gRenderer, 0, 0, 0, 0xFF);
+                SDL_RenderFillRect(gRenderer, &paddle);
+                dot.render((int)game.ball.x, (int)game.ball.y);
+                hudLayer.render(gRenderer);
+                SDL_RenderPresent(gRenderer);
+            }
+        });
+    }
+}
+
+//Brick break particles: moving a full pool, and drawing a few bursts and a full pool.
+//A full pool drawn and flushed must fit in a frame.
+void benchParticles(GlyphAtlas& atlas)
+{
+    static ParticleSystem particles;
+    particles.setAtlas(&atlas);
+    static const struct { const char* update; const char* render; int bursts; } RUNS[] =
+    {
+        { "update/20bursts", "render/20bursts", 20 },
+        { "update/full", "render/full", PARTICLE_CAPACITY }
+    };
+    for(size_t run = 0; run < sizeof(RUNS) / sizeof(RUNS[0]); run++)
+    {
+        //Long lived bursts from every brick in turn, so none run out while measured
+        particles.clear();
+        for(int b = 0; b < RUNS[run].bursts && particles.size() < PARTICLE_CAPACITY; b++)
+        {
+            int brick = b % BRICK_NUMBER;
+            particles.spawnBreak(brickRect(brick / COLS, brick % COLS), 0xC03030FF, brickScore(brick / COLS));
+        }
+        runBench("particles", RUNS[run].update, [&](long long n)
+        {
+            for(long long i = 0; i < n; i++)
+            {
+                particles.update(0);
+            }
+            gSink += particles.size();
+        });
+        runBench("particles", RUNS[run].render, [&](long long n)
+        {
+            for(long long i = 0; i < n; i++)
+            {
+                particles.render(gRenderer);
+            }
+            SDL_RenderPresent(gRenderer);
+        });
+    }
+
+    //Every particle drawn and finished, as one frame of the game would
+    runBench("particles", "render/full/frame", [&](long long n)
+    {
+        for(long long i = 0; i < n; i++)
+        {
+            particles.render(gRenderer);
+            flushRenderer();
+        }
+    });
+    if(!gResults.empty() && gResults.back().name == "render/full/frame" && gResults.back().nsPerOp > PARTICLE_FRAME_BUDGET_NS)
+    {
+        printf("Drawing a full particle pool takes %.2f ms, over the %.2f ms frame budget!\n",
+               gResults.back().nsPerOp / 1e6, PARTICLE_FRAME_BUDGET_NS / 1e6);
+        gOverBudget = true;
+    }
+    particles.clear();
+}
+
+//Game frames on the CPU framebuffer, at full and reduced resolution, in color and gray
+void benchRaster(const SoftFont& font)
+{
+    struct RasterRun
+    {
+        const char* name;
+        int scale;
+        SoftFormat format;
+        bool cached;
+    };
+    static const RasterRun RUNS[] =
+    {
+        { "cached/rgba", 1, SOFT_RGBA, true },
+        { "cached/gray", 1, SOFT_GRAY, true },
+        { "direct/rgba", 1, SOFT_RGBA, false },
+        { "direct/gray", 1, SOFT_GRAY, false },
+        { "direct/rgba/half", 2, SOFT_RGBA, false },
+        { "direct/gray/quarter", 4, SOFT_GRAY, false }
+    };
+
+    for(size_t run = 0; run < sizeof(RUNS) / sizeof(RUNS[0]); run++)
+    {
+        SoftRaster raster;
+        raster.init(RUNS[run].scale, RUNS[run].format);
+        raster.loadSprite("dot.bmp");
+        raster.setFont(font);
+        raster.setMessage("Hit UP to start/pause/resume/quit");
+        vector<uint8_t> pixels(raster.pitch() * raster.height());
+
+        GameState game;
+        initGame(game);
+        runBench("raster", RUNS[run].name, [&](long long n)
+        {
+            for(long long i = 0; i < n; i++)
+            {
+                if(gameOver(game) || gameWon(game))
+                {
+                    initGame(game);
+                }
+                step(game, followBall(game));
+
+                if(RUNS[run].cached)
+                {
+                    raster.render(game);
+                    gSink += raster.pixels()[0];
+                }
+                else
+                {
+                    raster.renderInto(&pixels[0], raster.pitch(), game);
+                    gSink += pixels[0];
+                }
+            }
+        });
+    }
+}
+
+//Writes the results as JSON
+bool writeResults()
+{
+    FILE* out = gOutPath != NULL ? fopen(gOutPath, "w") : stdout;
+    if(out == NULL)
+    {
+        printf("Unable to create %s!\n", gOutPath);
+        return false;
+    }
+
+    fprintf(out, "{\n  \"video_driver\": \"%s\",\n  \"renderer\": \"software\",\n  \"min_seconds\": %g,\n  \"benchmarks\": [\n", gVideoDriver, gMinSeconds);
+    for(size_t i = 0; i < gResults.size(); i++)
+    {
+        const BenchResult& r = gResults[i];
+        fprintf(out, "    { \"group\": \"%s\", \"name\": \"%s\", \"iterations\": %lld, \"ns_per_op\": %.2f }%s\n",
+                r.group.c_str(), r.name.c_str(), r.iterations, r.nsPerOp, i + 1 < gResults.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+
+    if(out != stdout)
+    {
+        fclose(out);
+    }
+    return true;
+}
+
+int main(int argc, char* args[])
+{
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(args[i], "--out") == 0 && i + 1 < argc)
+        {
+            gOutPath = args[++i];
+        }
+        else if(strcmp(args[i], "--min-time") == 0 && i + 1 < argc)
+        {
+            gMinSeconds = atof(args[++i]);
+        }
+        else if(strcmp(args[i], "--driver") == 0 && i + 1 < argc)
+        {
+            gVideoDriver = args[++i];
+        }
+        else if(strcmp(args[i], "--filter") == 0 && i + 1 < argc)
+        {
+            gFilter = args[++i];
+        }
+        else
+        {
+            printf("Usage: %s [--out file.json] [--min-time seconds] [--driver offscreen|dummy] [--filter text]\n", args[0]);
+            return 1;
+        }
+    }
+
+    //Same inputs on every run
+    srand(1);
+
+    //The simulation needs nothing from SDL
+    benchCollision();
+    benchLevel();
+    benchBatch();
+    benchRollback();
+
+    //Whether the wall, text, frame, particle and raster groups got a renderer and their media
+    bool rendered = false;
+
+    //Headless video with the software renderer
+    if(gVideoDriver == NULL)
+    {
+        gVideoDriver = headlessVideoDriver();
+    }
+    SDL_setenv("SDL_VIDEODRIVER", gVideoDriver, 1);
+    if(SDL_Init(SDL_INIT_VIDEO) < 0)
+    {
+        printf("SDL could not initialize! SDL Error: %s\n", SDL_GetError());
+        writeResults();
+        return 1;
+    }
+    if(TTF_Init() == -1)
+    {
+        printf("SDL_ttf could not initialize! SDL_ttf Error: %s\n", TTF_GetError());
+    }
+
+    gWindow = SDL_CreateWindow("Breakout bench", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_HIDDEN);
+    if(gWindow != NULL)
+    {
+        gRenderer = SDL_CreateRenderer(gWindow, -1, SDL_RENDERER_SOFTWARE | SDL_RENDERER_TARGETTEXTURE);
+    }
+
+    if(gRenderer == NULL)
+    {
+        printf("Renderer could not be created! SDL Error: %s\n", SDL_GetError());
+    }
+    else
+    {
+        benchWall();
+
+        LTexture dot;
+        GlyphAtlas atlas;
+        SoftFont softFont;
+        gFont = TTF_OpenFont("Rabbit On The Moon.ttf", 28);
+        if(gFont == NULL || !atlas.rasterize(gFont) || !atlas.softFont(softFont) || !atlas.upload(gRenderer) || !dot.loadFromFile("dot.bmp"))
+        {
+            printf("Failed to load media, skipping text, frame and raster benchmarks!\n");
+        }
+        else
+        {
+            benchText(atlas);
+            benchFrames(atlas, dot);
+            benchParticles(atlas);
+            benchRaster(softFont);
+            rendered = true;
+        }
+
+        atlas.free();
+        dot.free();
+        TTF_CloseFont(gFont);
+        gFont = NULL;
+        SDL_DestroyRenderer(gRenderer);
+        gRenderer = NULL;
+    }
+
+    SDL_DestroyWindow(gWindow);
+    gWindow = NULL;
+    TTF_Quit();
+    SDL_Quit();
+
+    //A run without the rendering groups must not pass for a full baseline
+    if(!rendered)
+    {
+        printf("Rendering benchmarks could not run!\n");
+    }
+    return writeResults() && rendered && !gOverBudget ? 0 : 1;
+}
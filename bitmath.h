@@ -0,0 +1,50 @@
+//Integer and bit helpers shared by the brick boards, the level broad phase and the brick store
+#ifndef BITMATH_H
+#define BITMATH_H
+
+#include <stdint.h>
+
+//Integer division rounding towards negative infinity
+constexpr int floorDiv(int a, int b)
+{
+    return a / b - ((a % b != 0) && ((a < 0) != (b < 0)) ? 1 : 0);
+}
+
+//Mask of the lowest n bits, n from 0 to 64
+constexpr uint64_t lowBits(int n)
+{
+    return n >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << n) - 1;
+}
+
+//Index of the lowest set bit of a non zero word
+inline int lowestBit(uint64_t v)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(v);
+#else
+    int index = 0;
+    while(!(v & 1))
+    {
+        v >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+//Number of set bits in a word
+inline int popCount(uint64_t v)
+{
+#if defined(__GNUC__)
+    return __builtin_popcountll(v);
+#else
+    int count = 0;
+    for(; v != 0; v &= v - 1)
+    {
+        count++;
+    }
+    return count;
+#endif
+}
+
+#endif
@@ -0,0 +1,100 @@
+//Brick boards as compile time configurations; Level is the runtime board behind the same interface
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <stdint.h>
+#include "game.h"
+#include "bitmath.h"
+
+//A regular wall whose geometry is known at compile time and fits one 64 bit alive mask.
+//Divisions by the pitch become multiplies, and the query builds the mask of every brick under a box
+//without loops or branches, then walks the set bits.
+template<int OriginX, int OriginY, int PitchX, int PitchY, int BrickW, int BrickH, int Rows, int Cols>
+struct FixedBoard
+{
+    static_assert(Rows > 0 && Cols > 0 && Rows * Cols <= 64, "a fixed board must fit one alive mask");
+    static_assert(PitchX > 0 && PitchY > 0 && BrickW > 0 && BrickH > 0, "bricks need a size and a pitch");
+
+    static const int ROWS = Rows;
+    static const int COLS = Cols;
+    static const int BRICKS = Rows * Cols;
+
+    //Bricks a query can return, the whole board
+    static const int MAX_CANDIDATES = BRICKS;
+
+    //Every brick of the board
+    static constexpr uint64_t full()
+    {
+        return lowBits(BRICKS);
+    }
+
+    static constexpr BrickGrid grid()
+    {
+        return BrickGrid{ OriginX, OriginY, PitchX, PitchY, BrickW, BrickH, Rows, Cols };
+    }
+
+    static constexpr Rect rect(int index)
+    {
+        return Rect{ OriginX + index % Cols * PitchX, OriginY + index / Cols * PitchY, BrickW, BrickH };
+    }
+
+    //The first brick of every row
+    static constexpr uint64_t rowStarts(int rows = Rows)
+    {
+        return rows == 0 ? 0 : rowStarts(rows - 1) | ((uint64_t)1 << ((rows - 1) * Cols));
+    }
+
+    //Bits of the bricks overlapping a box, alive or not
+    static uint64_t cover(const Rect& box)
+    {
+        //Columns and rows whose bricks reach into the box, as in queryGrid
+        int colMin = floorDiv(box.x - OriginX - BrickW, PitchX) + 1;
+        int colMax = floorDiv(box.x + box.w - OriginX - 1, PitchX) + 1;
+        int rowMin = floorDiv(box.y - OriginY - BrickH, PitchY) + 1;
+        int rowMax = floorDiv(box.y + box.h - OriginY - 1, PitchY) + 1;
+
+        //Clip the half open ranges to the board, an empty range gives an empty mask
+        colMin = colMin < 0 ? 0 : colMin > Cols ? Cols : colMin;
+        colMax = colMax < 0 ? 0 : colMax > Cols ? Cols : colMax;
+        rowMin = rowMin < 0 ? 0 : rowMin > Rows ? Rows : rowMin;
+        rowMax = rowMax < 0 ? 0 : rowMax > Rows ? Rows : rowMax;
+
+        //The column span of one row, repeated on every row in range; rows never carry into each other
+        uint64_t cols = lowBits(colMax) & ~lowBits(colMin);
+        uint64_t rows = rowStarts() & lowBits(rowMax * Cols) & ~lowBits(rowMin * Cols);
+        return cols * rows;
+    }
+
+    //Finds the standing bricks overlapping a box, in row then column order like queryGrid
+    static int query(const uint64_t* alive, const Rect& box, int* hits, int maxHits)
+    {
+        uint64_t bits = alive[0] & cover(box) & full();
+        int count = 0;
+        for(; bits != 0 && count < maxHits; bits &= bits - 1)
+        {
+            hits[count++] = lowestBit(bits);
+        }
+        return count;
+    }
+};
+
+//Row colors of the classic wall, top to bottom, as 0xRRGGBBAA: red, orange, green, yellow, blue
+constexpr uint32_t CLASSIC_COLORS[ROWS] = { 0xFF0000FF, 0xFF9000FF, 0x008000FF, 0xFFFF00FF, 0x0000FFFF };
+
+//The classic wall, with the score and color of each brick looked up from its row
+struct ClassicBoard : FixedBoard<CLASSIC_GRID.originX, CLASSIC_GRID.originY, CLASSIC_GRID.pitchX, CLASSIC_GRID.pitchY,
+                                 CLASSIC_GRID.brickW, CLASSIC_GRID.brickH, CLASSIC_GRID.rows, CLASSIC_GRID.cols>
+{
+    //The top row is worth 5 points, the bottom row 1
+    static constexpr int score(int index)
+    {
+        return ROWS - index / COLS;
+    }
+
+    static constexpr uint32_t color(int index)
+    {
+        return CLASSIC_COLORS[index / COLS];
+    }
+};
+
+#endif
@@ -4,146 +4,209 @@
 #include <SDL_mixer.h>
 #include <SDL_ttf.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
 #include <string>
-#include <sstream>
+#include <vector>
+#include "game.h"
+#include "board.h"
+#include "level.h"
+#include "ltexture.h"
+#include "glyphatlas.h"
+#include "headless.h"
+#include "wallbatch.h"
+#include "layers.h"
+#include "replay.h"
+#include "assetpack.h"
+#include "trace.h"
+#include "simthread.h"
+#include "capture.h"
+#include "particles.h"
 
 using namespace std;
 
-//Screen dimension constants
-const int SCREEN_WIDTH = 400;
-const int SCREEN_HEIGHT = 600;
-const int ROWS = 5;
-const int COLS = 10;
-const int BRICK_NUMBER = ROWS * COLS;
-
-int lives = 3, score = 0, brick = BRICK_NUMBER;
-
-string scoreText = "Score: ";
-string lifeText = "Lives: ";
+//HUD label strings, formatted in place when the values change
+char scoreText[32] = "Score:0";
+char lifeText[32] = "Lives:3";
 string msgText = "Hit UP to start/pause/resume/quit";
 
-//Texture wrapper class
-class LTexture
-{
-	public:
-		//Initializes variables
-		LTexture();
+//Present in sync with the display, otherwise cap at gFrameCap frames per second (0 = uncapped)
+bool gVsync = true;
+int gFrameCap = 0;
 
-		//Deallocates memory
-		~LTexture();
+//Seed of the game, recording written on exit, and recording to replay headless instead of playing
+uint32_t gSeed = 0;
+const char* gRecordPath = NULL;
+const char* gReplayPath = NULL;
 
-		//Loads image at specified path
-		bool loadFromFile( std::string path );
+//Trace of the main loop phases written on exit, tracing is off when NULL
+const char* gTracePath = NULL;
 
-		//Creates image from font string
-        bool loadFromRenderedText( std::string textureText, SDL_Color textColor );
+//Level played instead of the classic wall, when a path is given
+const char* gLevelPath = NULL;
+Level gLevel;
 
-		//Deallocates texture
-		void free();
+//Video of the session or replay, captured when a path is given, and the tick of the last frame captured
+const char* gCapturePath = NULL;
+VideoCapture gCapture;
+uint32_t gCapturedTick = 0;
 
-		//Set color modulation
-		void setColor(Uint8 red, Uint8 green, Uint8 blue);
+//Frames the frame time histogram covers, and its buckets of one millisecond, the last one holding everything slower
+const int FRAME_HISTORY = 240;
+const int FRAME_BUCKETS = 34;
 
-		//Set blending
-		void setBlendMode(SDL_BlendMode blending);
+//Recent frame times in milliseconds, oldest overwritten first
+double gFrameTimes[FRAME_HISTORY];
+int gFrameTimeCount = 0;
+int gFrameTimeNext = 0;
 
-		//Set alpha modulation
-		void setAlpha(Uint8 alpha);
+//Frames of the history in each bucket
+int gFrameBuckets[FRAME_BUCKETS];
 
-		//Renders texture at given point
-		void render(int x, int y, SDL_Rect* clip = NULL, double angle = 0.0, SDL_Point* center = NULL, SDL_RendererFlip flip = SDL_FLIP_NONE);
+//Frame time overlay, toggled with F3
+bool gShowFrameTimes = false;
 
-		//Gets image dimensions
-		int getWidth();
-		int getHeight();
+//Input to present latency is measured and reported on exit when set; probing also presses the paddle keys
+//by itself every LATENCY_PROBE_INTERVAL milliseconds, so no player is needed
+bool gMeasureLatency = false;
+bool gLatencyProbe = false;
+const Uint32 LATENCY_PROBE_INTERVAL = 250;
 
-	private:
-		//The actual hardware texture
-		SDL_Texture* mTexture;
+//Latencies measured so far in milliseconds: input to the tick that applied it, that tick to the present of
+//the first frame drawn from it, and the two together
+vector<double> gInputToTick;
+vector<double> gTickToPresent;
+vector<double> gInputToPresent;
 
-		//Image dimensions
-		int mWidth;
-		int mHeight;
+//Screens of the game flow; only FLOW_PLAYING runs the clock, the others sleep until an event arrives
+enum GameFlow
+{
+    FLOW_TITLE,
+    FLOW_PLAYING,
+    FLOW_PAUSED,
+    FLOW_GAME_OVER,
+    FLOW_WON,
+    FLOW_QUIT
 };
 
-//The user controlled paddle
-class Paddle
+//Arrow keys held, tracked from their key events
+struct PaddleKeys
 {
-    public:
-		//The dimensions of the paddle
-		static const int PADDLE_WIDTH = 60;
-		static const int PADDLE_HEIGHT = 10;
+    bool left, right;
+};
 
-		//Maximum axis velocity of the paddle
-		static const int PADDLE_VEL = 10;
+//A startup loader and its thread
+struct LoadJob
+{
+    const char* name;
+    SDL_ThreadFunction function;
+    SDL_Thread* thread;
+    int result;
+};
 
-        //paddle's collision box
-        SDL_Rect pCollider;
+//Reads command line options
+void parseArgs(int argc, char* args[]);
 
-		//Initializes the variables
-		Paddle();
+//Re-runs a recording headless and reports speed and hash checks, returns the exit code
+int playReplay(const char* path);
 
-		//Takes key presses and adjusts the paddle's velocity
-		void handleEvent(SDL_Event& e);
+//Renders every tick of a recording into the capture, on a headless video driver unless another is set
+bool captureReplay(const Replay& replay, ReplayResult& result);
 
-		//Moves the paddle and checks collision
-		void move();
+//Sets up a fresh game on the level played, or on the classic wall
+void newGame(GameState& state, LevelState& level);
 
-		//Shows the paddle on the screen
-		void render();
+//Starts up SDL and creates window
+bool init();
 
-    private:
-		//The X and Y offsets of the paddle
-		int pPosX, pPosY;
+//Maps the asset archive and starts the loaders, then creates the layers while they run
+void startLoading();
 
-		//The velocity of the paddle
-		int pVelX, pVelY;
-};
+//Waits for the loaders and uploads what they decoded; textures are made on the render thread
+bool loadMedia();
 
-//The dot that will move around on the screen
-class Dot
-{
-    public:
-		//The dimensions of the dot
-		static const int DOT_WIDTH = 20;
-		static const int DOT_HEIGHT = 20;
+//Loaders run on their own threads during startup, returning 1 on success
+int loadAudio(void* data);
+int loadText(void* data);
+int loadImages(void* data);
 
-		//Maximum axis velocity of the dot
-		static const int DOT_VEL = 10;
+//Maps the asset archive next to the executable
+void openAssets();
 
-		//Initializes the variables
-		Dot();
+//Asset loaders, taking the asset from the archive when it holds it and from the loose file otherwise
+Mix_Chunk* loadSound(const char* name);
+TTF_Font* loadFont(const char* name, int size);
 
-		//Moves the dot and checks collision
-		void move(Paddle p);
+//Frees media and shuts down SDL
+void close();
 
-		//Shows the dot on the screen
-		void render();
+//Starts a loader on its own thread, or runs it in place if the thread can't be made
+void startJob(LoadJob& job);
 
-    private:
-		//The X and Y offsets of the dot
-		int dPosX, dPosY;
+//Waits for a loader and returns whether it succeeded
+bool finishJob(LoadJob& job);
 
-		//The velocity of the dot
-		int dVelX, dVelY;
+//Takes presses and releases of the arrow keys, returns true when the direction they hold changed
+bool handlePaddleEvent(const SDL_Event& e, PaddleKeys& keys);
 
-		//Dot's collision box
-		SDL_Rect dCollider;
-};
+//Direction the held keys move the paddle: -1 left, 0 none or both, 1 right
+int paddleDirection(const PaddleKeys& keys);
 
-//Starts up SDL and creates window
-bool init();
+//Time an input event happened on the simulation clock, to the millisecond SDL stamps it with
+uint64_t eventTime(const SDL_Event& e);
 
-//Loads media
-bool loadMedia();
+//Pushes the next synthetic paddle key event once it is due
+void pushLatencyProbe(Uint32& nextProbe, int& probeStep);
 
-//Frees media and shuts down SDL
-void close();
+//Adds the latency of the paddle input a just presented snapshot was the first to show
+void recordLatency(const Snapshot& shown, uint64_t presentTime);
+
+//Prints the measured latencies
+void reportLatency();
+
+//Renders the standing bricks of the wall, the level's when its alive mask is given
+void updateWall(const GameState& state, const uint64_t* levelAlive);
+
+//Shows the paddle and the dot on the screen, blended between the previous and current tick
+void renderPaddle(const Paddle& prev, const Paddle& cur, double alpha);
+void renderDot(const Ball& prev, const Ball& cur, double alpha);
+
+//Plays sounds and updates labels for the events raised by a tick
+void playEvents(unsigned events, const GameState& state);
+
+//Bursts particles out of every brick broken since the last snapshot shown
+void spawnBreakEffects(const Snapshot& shown);
+
+//Updates the score and life label strings
+void updateScoreLabel(int score);
+void updateLifeLabel(int lives);
+
+//Draws the score, life and message labels
+void renderLabels();
+
+//Draws a label from the published glyph atlas, nothing while the atlas is still loading
+void renderText(int x, int y, const char* text);
+
+//Composites the cached wall and HUD layers with the moving dot and paddle
+void renderFrame(const GameState& prev, const GameState& cur, const uint64_t* levelAlive, double alpha);
 
-//Box collision detector
-bool checkCollision(SDL_Rect a, SDL_Rect b);
+//Shows the end of game message on a blank screen
+void renderMessageScreen();
 
-bool handleCollision(SDL_Rect c, Paddle p);
+//Returns the screen the game moves to after an event
+GameFlow nextFlow(GameFlow flow, const SDL_Event& e);
+
+//Adds a frame to the frame time history
+void recordFrameTime(double ms);
+
+//Draws the frame time histogram over the game
+void renderFrameTimes();
+
+//Reads the frame just drawn into the capture if the game reached a new tick. Without wait the frame is dropped
+//when the writer is behind, and the next frame captured covers its ticks.
+void captureFrame(uint32_t tick, bool wait);
 
 //The window we'll be rendering to
 SDL_Window* gWindow = NULL;
@@ -151,9 +214,6 @@ SDL_Window* gWindow = NULL;
 //The window renderer
 SDL_Renderer* gRenderer = NULL;
 
-//Array to hold brick wall
-SDL_Rect bricks[ROWS][COLS];
-
 //paddle bounce sound effect
 Mix_Chunk *bounce = NULL;
 
@@ -166,262 +226,423 @@ LTexture gDotTexture;
 //Globally used font
 TTF_Font *gFont = NULL;
 
-//Score texture
-LTexture gScoreTexture;
-//Life texture
-LTexture gLifeTexture;
-//Message texture
-LTexture gMsgTexture;
+//Mapped asset archive; the sounds and the font read from it, so it stays open until close()
+AssetPack gAssets;
 
-LTexture::LTexture()
-{
-	//Initialize
-	mTexture = NULL;
-	mWidth = 0;
-	mHeight = 0;
-}
+//Dot decoded from a loose file, waiting for upload
+SDL_Surface* gDotSurface = NULL;
 
-LTexture::~LTexture()
+//Loaders started together, audio first as opening the device is the slowest
+const int LOAD_JOB_COUNT = 3;
+LoadJob gLoadJobs[LOAD_JOB_COUNT] =
 {
-	//Deallocate
-	free();
-}
+    { "audio loader", loadAudio, NULL, 0 },
+    { "text loader", loadText, NULL, 0 },
+    { "image loader", loadImages, NULL, 0 }
+};
 
-bool LTexture::loadFromFile( std::string path )
-{
-	//Get rid of preexisting texture
-	free();
+//Performance counter when main started, startup times are measured from it
+Uint64 gStartTime = 0;
 
-	//The final texture
-	SDL_Texture* newTexture = NULL;
+//Batched brick wall
+WallBatch gWallBatch;
 
-	//Load image at specified path
-	SDL_Surface* loadedSurface = IMG_Load( path.c_str() );
-	if( loadedSurface == NULL )
-	{
-		printf( "Unable to load image %s! SDL_image Error: %s\n", path.c_str(), IMG_GetError() );
-	}
-	else
-	{
-		//Color key image
-		SDL_SetColorKey( loadedSurface, SDL_TRUE, SDL_MapRGB( loadedSurface->format, 0, 0xFF, 0xFF ) );
+//Cached wall on white background, and the labels drawn over everything
+RenderLayer gWallLayer;
+RenderLayer gHudLayer;
 
-		//Create texture from surface pixels
-        newTexture = SDL_CreateTextureFromSurface( gRenderer, loadedSurface );
-		if( newTexture == NULL )
-		{
-			printf( "Unable to create texture from %s! SDL Error: %s\n", path.c_str(), SDL_GetError() );
-		}
-		else
-		{
-			//Get image dimensions
-			mWidth = loadedSurface->w;
-			mHeight = loadedSurface->h;
-		}
+//Alive mask and bricks left the wall layer was drawn from
+uint64_t gWallLayerBricks = 0;
+int gWallLayerLeft = -1;
 
-		//Get rid of old loaded surface
-		SDL_FreeSurface( loadedSurface );
-	}
+//Glyphs of the font used to draw every label, filled in by the text loader
+GlyphAtlas gTextAtlas;
+
+//The atlas as the render thread sees it; set by loadMedia once the loader has finished with it
+GlyphAtlas* gText = NULL;
+
+//Debris, sparks and score pop ups of broken bricks
+ParticleSystem gParticles;
+
+//Standing bricks the particles last saw, so each broken brick bursts once
+uint64_t gParticleBricks = 0;
+vector<uint64_t> gParticleAlive;
+
+//Label text color
+const SDL_Color TEXT_COLOR = { 0, 0, 0, 0xFF };
+
+bool handlePaddleEvent( const SDL_Event& e, PaddleKeys& keys )
+{
+    //Only presses and releases count, key repeats hold nothing new
+	if( ( e.type != SDL_KEYDOWN && e.type != SDL_KEYUP ) || e.key.repeat != 0 )
+    {
+        return false;
+    }
 
-	//Return success
-	mTexture = newTexture;
-	return mTexture != NULL;
+    //Adjust the held keys
+    int before = paddleDirection( keys );
+    bool down = e.type == SDL_KEYDOWN;
+    switch( e.key.keysym.sym )
+    {
+        case SDLK_LEFT: keys.left = down; break;
+        case SDLK_RIGHT: keys.right = down; break;
+    }
+    return paddleDirection( keys ) != before;
+}
+
+int paddleDirection( const PaddleKeys& keys )
+{
+    return ( keys.right ? 1 : 0 ) - ( keys.left ? 1 : 0 );
 }
 
-bool LTexture::loadFromRenderedText( std::string textureText, SDL_Color textColor )
+uint64_t eventTime(const SDL_Event& e)
 {
-    //Get rid of preexisting texture
-    free();
+    //Age on the millisecond clock SDL stamps events with; anything odd counts as just now
+    uint64_t now = SimThread::now();
+    Uint32 age = SDL_GetTicks() - e.common.timestamp;
+    return age < 1000 ? now - (uint64_t)age * 1000000 : now;
+}
 
-    //Render text surface
-    SDL_Surface* textSurface = TTF_RenderText_Solid( gFont, textureText.c_str(), textColor );
-    if( textSurface == NULL )
+void pushLatencyProbe(Uint32& nextProbe, int& probeStep)
+{
+    Uint32 now = SDL_GetTicks();
+    if(nextProbe != 0 && (Sint32)(now - nextProbe) < 0)
     {
-        printf( "Unable to render text surface! SDL_ttf Error: %s\n", TTF_GetError() );
+        return;
     }
-    else
+    nextProbe = now + LATENCY_PROBE_INTERVAL;
+
+    //Hold left, let go, hold right, let go, so the paddle wanders around where it is
+    static const SDL_Keycode PROBE_KEYS[] = { SDLK_LEFT, SDLK_LEFT, SDLK_RIGHT, SDLK_RIGHT };
+    SDL_Event e;
+    SDL_zero(e);
+    e.type = probeStep % 2 == 0 ? SDL_KEYDOWN : SDL_KEYUP;
+    e.key.state = probeStep % 2 == 0 ? SDL_PRESSED : SDL_RELEASED;
+    e.key.keysym.sym = PROBE_KEYS[probeStep];
+    e.key.keysym.scancode = SDL_GetScancodeFromKey(PROBE_KEYS[probeStep]);
+    SDL_PushEvent(&e);
+    probeStep = (probeStep + 1) % 4;
+}
+
+void recordLatency(const Snapshot& shown, uint64_t presentTime)
+{
+    gInputToTick.push_back((double)(int64_t)(shown.inputTickTime - shown.inputTime) / 1e6);
+    gTickToPresent.push_back((double)(int64_t)(presentTime - shown.inputTickTime) / 1e6);
+    gInputToPresent.push_back((double)(int64_t)(presentTime - shown.inputTime) / 1e6);
+}
+
+//Prints the spread of one latency stage
+static void printLatency(const char* name, vector<double> ms)
+{
+    sort(ms.begin(), ms.end());
+    double mean = 0;
+    for(size_t i = 0; i < ms.size(); i++)
     {
-        //Create texture from surface pixels
-        mTexture = SDL_CreateTextureFromSurface( gRenderer, textSurface );
-        if( mTexture == NULL )
-        {
-            printf( "Unable to create texture from rendered text! SDL Error: %s\n", SDL_GetError() );
-        }
-        else
-        {
-            //Get image dimensions
-            mWidth = textSurface->w;
-            mHeight = textSurface->h;
-        }
+        mean += ms[i];
+    }
+    mean /= ms.size();
+    printf("  %-17s mean %6.2f  min %6.2f  median %6.2f  p95 %6.2f  max %6.2f ms\n", name, mean, ms[0], ms[ms.size() / 2],
+           ms[ms.size() * 95 / 100], ms[ms.size() - 1]);
+}
 
-        //Get rid of old surface
-        SDL_FreeSurface( textSurface );
+void reportLatency()
+{
+    if(gInputToPresent.empty())
+    {
+        printf("No paddle input reached the screen, no latency measured\n");
+        return;
     }
 
-    //Return success
-    return mTexture != NULL;
+    //Present returning is the last moment the game sees, the display adds its scan out on top
+    printf("Paddle input latency over %d inputs, %s:\n", (int)gInputToPresent.size(),
+           gVsync ? "vsync" : gFrameCap > 0 ? "frame cap" : "uncapped");
+    printLatency("input to tick", gInputToTick);
+    printLatency("tick to present", gTickToPresent);
+    printLatency("input to present", gInputToPresent);
 }
 
-void LTexture::free()
+//Position between two ticks, rounded to the nearest pixel
+static int interpolate(double from, double to, double alpha)
 {
-	//Free texture if it exists
-	if( mTexture != NULL )
-	{
-		SDL_DestroyTexture( mTexture );
-		mTexture = NULL;
-		mWidth = 0;
-		mHeight = 0;
-	}
+    return (int)floor(from + (to - from) * alpha + 0.5);
 }
 
-void LTexture::setColor( Uint8 red, Uint8 green, Uint8 blue )
+void renderDot(const Ball& prev, const Ball& cur, double alpha)
 {
-	//Modulate texture rgb
-	SDL_SetTextureColorMod( mTexture, red, green, blue );
+    //Show the dot
+	gDotTexture.render( interpolate(prev.x, cur.x, alpha), interpolate(prev.y, cur.y, alpha) );
 }
 
-void LTexture::render( int x, int y, SDL_Rect* clip, double angle, SDL_Point* center, SDL_RendererFlip flip )
+void renderPaddle(const Paddle& prev, const Paddle& cur, double alpha)
 {
-	//Set rendering space and render to screen
-	SDL_Rect renderQuad = { x, y, mWidth, mHeight };
-
-	//Set clip rendering dimensions
-	if( clip != NULL )
-	{
-		renderQuad.w = clip->w;
-		renderQuad.h = clip->h;
-	}
+    SDL_Rect paddle = {interpolate(prev.x, cur.x, alpha), interpolate(prev.y, cur.y, alpha), PADDLE_WIDTH, PADDLE_HEIGHT};
+    SDL_SetRenderDrawColor(gRenderer, 0, 0, 0, 255 );
+    SDL_RenderFillRect(gRenderer, &paddle);
+}
 
-	//Render to screen
-	SDL_RenderCopyEx( gRenderer, mTexture, clip, &renderQuad, angle, center, flip );
+void playEvents(unsigned events, const GameState& state)
+{
+    if(events & EVENT_BOUNCE)
+    {
+        Mix_PlayChannel(-1, bounce, 0);
+    }
+    if(events & EVENT_BREAK)
+    {
+        Mix_PlayChannel(-1, breaking, 0);
+        updateScoreLabel(state.score);
+    }
+    if(events & EVENT_LIFE_LOST)
+    {
+        updateLifeLabel(state.lives);
+    }
 }
 
-Dot::Dot()
+void spawnBreakEffects(const Snapshot& shown)
 {
-    //Initialize the offsets
-    dPosX = (SCREEN_WIDTH - DOT_WIDTH) / 2;
-    dPosY = (SCREEN_HEIGHT - DOT_HEIGHT) / 2;
+    if(gLevelPath != NULL)
+    {
+        for(size_t w = 0; w < shown.levelAlive.size() && w < gParticleAlive.size(); w++)
+        {
+            uint64_t broken = gParticleAlive[w] & ~shown.levelAlive[w];
+            for(int b = 0; broken != 0; b++, broken >>= 1)
+            {
+                if(broken & 1)
+                {
+                    int i = (int)w * 64 + b;
+                    gParticles.spawnBreak(gLevel.rect(i), gLevel.color(i), gLevel.score(i));
+                }
+            }
+        }
 
-	//Set collision box dimension
-	dCollider.w = DOT_WIDTH;
-	dCollider.h = DOT_HEIGHT;
+        //Same size every time, so the copy reuses the storage
+        gParticleAlive = shown.levelAlive;
+    }
+    else
+    {
+        uint64_t broken = gParticleBricks & ~shown.state.bricks;
+        for(int i = 0; i < ClassicBoard::BRICKS; i++)
+        {
+            if((broken >> i) & 1)
+            {
+                gParticles.spawnBreak(ClassicBoard::rect(i), ClassicBoard::color(i), ClassicBoard::score(i));
+            }
+        }
+        gParticleBricks = shown.state.bricks;
+    }
+}
 
-    //Initialize the velocity
-    dVelX = 3;
-    dVelY = 3;
+void updateScoreLabel(int score)
+{
+    //concatenate score text and score, no texture is touched
+    snprintf(scoreText, sizeof(scoreText), "Score:%d", score);
+    gHudLayer.invalidate();
 }
 
-Paddle::Paddle()
+void updateLifeLabel(int lives)
 {
-    //Initialize the offsets
-    pPosX = (SCREEN_WIDTH - PADDLE_WIDTH) / 2;
-    pPosY = 580;
+    //concatenate life text and lives, no texture is touched
+    snprintf(lifeText, sizeof(lifeText), "Lives:%d", lives);
+    gHudLayer.invalidate();
+}
+
+void renderLabels()
+{
+    //Render text labels from the glyph atlas
+    renderText(5, 5, scoreText);
+    renderText(320, 5, lifeText);
+    renderText(5, (SCREEN_HEIGHT / 2) + 20, msgText.c_str());
+}
 
-	//Set collision box dimension
-	pCollider.w = PADDLE_WIDTH;
-	pCollider.h = PADDLE_HEIGHT;
-    pCollider.x = pPosX;
-    pCollider.y = pPosY;
-    //Initialize the velocity
-    pVelX = 0;
+void renderText(int x, int y, const char* text)
+{
+    if(gText != NULL)
+    {
+        gText->render(gRenderer, x, y, text, TEXT_COLOR);
+    }
 }
 
-void Paddle::handleEvent( SDL_Event& e )
+void parseArgs(int argc, char* args[])
 {
-    //If a key was pressed
-	if( e.type == SDL_KEYDOWN && e.key.repeat == 0 )
+    for(int i = 1; i < argc; i++)
     {
-        //Adjust the velocity
-        switch( e.key.keysym.sym )
+        //Present as fast as possible instead of waiting for vsync
+        if(strcmp(args[i], "--novsync") == 0)
+        {
+            gVsync = false;
+        }
+        //Cap the frame rate without vsync
+        else if(strcmp(args[i], "--fps") == 0 && i + 1 < argc)
+        {
+            gVsync = false;
+            gFrameCap = atoi(args[++i]);
+        }
+        //Launch direction of the dot
+        else if(strcmp(args[i], "--seed") == 0 && i + 1 < argc)
+        {
+            gSeed = (uint32_t)strtoul(args[++i], NULL, 10);
+        }
+        //Record the session to a file
+        else if(strcmp(args[i], "--record") == 0 && i + 1 < argc)
+        {
+            gRecordPath = args[++i];
+        }
+        //Replay a recorded session without a window
+        else if(strcmp(args[i], "--replay") == 0 && i + 1 < argc)
         {
-            case SDLK_LEFT: pVelX = -PADDLE_VEL; break;
-            case SDLK_RIGHT: pVelX = PADDLE_VEL; break;
+            gReplayPath = args[++i];
+        }
+        //Trace the main loop phases to a file
+        else if(strcmp(args[i], "--trace") == 0 && i + 1 < argc)
+        {
+            gTracePath = args[++i];
+            traceEnable(true);
+        }
+        //Play a level file instead of the classic wall
+        else if(strcmp(args[i], "--level") == 0 && i + 1 < argc)
+        {
+            gLevelPath = args[++i];
+        }
+        //Capture video of the session, or of the replay, as .y4m or raw RGB frames
+        else if(strcmp(args[i], "--capture") == 0 && i + 1 < argc)
+        {
+            gCapturePath = args[++i];
+        }
+        //Measure the time from paddle input to the frame showing it, reported on exit
+        else if(strcmp(args[i], "--latency") == 0)
+        {
+            gMeasureLatency = true;
+        }
+        //Measure it on synthetic key presses, without a player
+        else if(strcmp(args[i], "--latency-probe") == 0)
+        {
+            gMeasureLatency = true;
+            gLatencyProbe = true;
+        }
+        else
+        {
+            printf("Unknown option %s\n", args[i]);
         }
     }
 }
 
-void Dot::move(Paddle p)
+int playReplay(const char* path)
 {
-    //Move the dot left or right
-    dPosX += dVelX;
-	dCollider.x = dPosX;
-
-    //If the dot collided or went too far to the left or right
-    if((dPosX < 0) || (dPosX + DOT_WIDTH > SCREEN_WIDTH) || handleCollision(dCollider, p))
+    Replay replay;
+    if(!loadReplay(path, replay))
     {
-        //Move back
-        dPosX -= dVelX;
-		dCollider.x = dPosX;
-		dVelX = -dVelX; //bounce to the opposite direction
+        return 1;
     }
 
-    //Move the dot up or down
-    dPosY += dVelY;
-	dCollider.y = dPosY;
-
-	//If the dot went too far down
-	if(dPosY + DOT_HEIGHT > SCREEN_HEIGHT)
+    //The recording only replays on the wall it was made on
+    uint32_t level = gLevelPath != NULL ? gLevel.checksum() : 0;
+    if(replay.level != level)
     {
-        //reset to original position
-        dPosX = (SCREEN_WIDTH - DOT_WIDTH) / 2;
-        dPosY = (SCREEN_HEIGHT - DOT_HEIGHT) / 2;
+        printf("Replay %s was recorded on %s!\n", path, replay.level == 0 ? "the classic wall" : "another level, pass it with --level");
+        return 1;
+    }
 
-        //update the life label
-        lives--;
-        SDL_Color textColor = { 0, 0, 0 };
-        stringstream sstm;
-        lifeText = "Lives:";
-        sstm << lifeText << lives;
-        lifeText = sstm.str();
-        gLifeTexture.loadFromRenderedText(lifeText, textColor);
-        gLifeTexture.render(320, 5);
+    //Time the run, nothing else happens in between
+    Uint64 start = SDL_GetPerformanceCounter();
+    ReplayResult result;
+    if(gCapturePath != NULL)
+    {
+        if(!captureReplay(replay, result))
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        result = runReplay(replay, gLevelPath != NULL ? &gLevel : NULL);
     }
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
 
-    //If the dot collided or went too far up
-    if((dPosY < 0) || handleCollision(dCollider, p))
+    printf("Replayed %u ticks in %.3f ms (%.0f ticks per second)\n", result.ticks, seconds * 1000, seconds > 0 ? result.ticks / seconds : 0);
+    printf("Score %d, lives %d, bricks left %d\n", result.state.score, result.state.lives, result.state.bricksLeft);
+    if(result.divergedAt >= 0)
+    {
+        printf("Diverged from the recording at tick %lld!\n", (long long)result.divergedAt);
+    }
+    if(!result.finalMatch)
     {
-        //Move back
-        dPosY -= dVelY;
-		dCollider.y = dPosY;
-		dVelY = -dVelY;        // bounce to the opposite direction
+        printf("Final state doesn't match the recording!\n");
     }
+
+    return result.divergedAt < 0 && result.finalMatch ? 0 : 1;
 }
 
-void Paddle::move()
+//Draws a replayed tick and captures it, context holds the state of the tick before
+static void captureTick(void* context, const GameState& state, const LevelState* level)
 {
-    //Move the paddle left or right
-    pPosX += pVelX;
-	pCollider.x = pPosX;
-
-    //If the paddle collided or went too far to the left or right
-    if((pPosX < 0) || (pPosX + PADDLE_WIDTH > SCREEN_WIDTH))
+    GameState& last = *(GameState*)context;
+    if(state.score != last.score)
     {
-        //Move back
-        pPosX -= pVelX;
-		pCollider.x = pPosX;
+        updateScoreLabel(state.score);
+    }
+    if(state.lives != last.lives)
+    {
+        updateLifeLabel(state.lives);
     }
-}
 
-void Dot::render()
-{
-    //Show the dot
-	gDotTexture.render( dPosX, dPosY );
+    renderFrame(last, state, level != NULL ? level->alive.data() : NULL, 1);
+    captureFrame(state.tick, true);
+    SDL_RenderPresent(gRenderer);
+    last = state;
 }
 
-void Paddle::render()
+bool captureReplay(const Replay& replay, ReplayResult& result)
 {
-    SDL_Rect paddle = {pPosX, pPosY, PADDLE_WIDTH, PADDLE_HEIGHT};
-    SDL_SetRenderDrawColor(gRenderer, 0, 0, 0, 255 );
-    SDL_RenderFillRect(gRenderer, &paddle);
+    //A headless machine has no display or sound card; offscreen when this SDL has it, dummy otherwise
+    SDL_setenv("SDL_VIDEODRIVER", headlessVideoDriver(), 0);
+    SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+    gVsync = false;
+
+    bool success = false;
+    if(!init())
+    {
+        printf("Failed to initialize!\n");
+    }
+    else
+    {
+        startLoading();
+        if(!loadMedia())
+        {
+            printf("Failed to load media!\n");
+        }
+        else if(gCapture.open(gCapturePath, SCREEN_WIDTH, SCREEN_HEIGHT, TICKS_PER_SECOND))
+        {
+            GameState last;
+            LevelState level;
+            if(gLevelPath != NULL)
+            {
+                initGame(last, level, gLevel, replay.seed);
+            }
+            else
+            {
+                initGame(last, replay.seed);
+            }
+            gCapturedTick = last.tick;
+
+            //Replays wait for the writer instead of dropping frames
+            result = runReplay(replay, gLevelPath != NULL ? &gLevel : NULL, captureTick, &last);
+            success = gCapture.close();
+            printf("Captured %u frames to %s\n", gCapture.written(), gCapturePath);
+        }
+    }
+
+    close();
+    return success;
 }
 
 bool init()
 {
+	TRACE_SCOPE("init");
+
 	//Initialization flag
 	bool success = true;
 
-	//Initialize SDL
-	if( SDL_Init( SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0 )
+	//Initialize SDL video, audio is brought up by the audio loader
+	if( SDL_Init( SDL_INIT_VIDEO ) < 0 )
 	{
 		printf( "SDL could not initialize! SDL Error: %s\n", SDL_GetError() );
 		success = false;
@@ -437,8 +658,13 @@ bool init()
 		}
 		else
 		{
-			//Create vsynced renderer for window
-			gRenderer = SDL_CreateRenderer( gWindow, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC );
+			//Create renderer for window, vsynced unless asked otherwise
+			Uint32 rendererFlags = SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE;
+			if( gVsync )
+			{
+				rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+			}
+			gRenderer = SDL_CreateRenderer( gWindow, -1, rendererFlags );
 			if( gRenderer == NULL )
 			{
 				printf( "Renderer could not be created! SDL Error: %s\n", SDL_GetError() );
@@ -448,28 +674,6 @@ bool init()
 			{
 				//Initialize renderer color
 				SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
-
-				//Initialize PNG loading
-				int imgFlags = IMG_INIT_PNG;
-				if( !( IMG_Init( imgFlags ) & imgFlags ) )
-				{
-					printf( "SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError() );
-					success = false;
-				}
-
-                //Initialize SDL_mixer
-                if( Mix_OpenAudio( 44100, MIX_DEFAULT_FORMAT, 2, 2048 ) < 0 )
-                {
-                    printf( "SDL_mixer could not initialize! SDL_mixer Error: %s\n", Mix_GetError() );
-                    success = false;
-                }
-
-                 //Initialize SDL_ttf
-                if( TTF_Init() == -1 )
-                {
-                    printf( "SDL_ttf could not initialize! SDL_ttf Error: %s\n", TTF_GetError() );
-                    success = false;
-                }
 			}
 		}
 	}
@@ -477,20 +681,27 @@ bool init()
 	return success;
 }
 
-bool loadMedia()
+int loadAudio(void*)
 {
-	//Loading success flag
-	bool success = true;
+    traceThreadName("audio loader");
+    TRACE_SCOPE("loadAudio");
 
-	//Load press texture
-	if( !gDotTexture.loadFromFile("dot.bmp"))
-	{
-		printf( "Failed to load dot texture!\n" );
-		success = false;
-	}
+    //Initialize SDL audio and SDL_mixer
+    if( SDL_InitSubSystem( SDL_INIT_AUDIO ) < 0 )
+    {
+        printf( "SDL audio could not initialize! SDL Error: %s\n", SDL_GetError() );
+        return 0;
+    }
+    if( Mix_OpenAudio( PACK_AUDIO_FREQUENCY, PACK_AUDIO_FORMAT, PACK_AUDIO_CHANNELS, 2048 ) < 0 )
+    {
+        printf( "SDL_mixer could not initialize! SDL_mixer Error: %s\n", Mix_GetError() );
+        return 0;
+    }
+
+    bool success = true;
 
     //Load sound effect
-	bounce = Mix_LoadWAV("bounce.wav");
+	bounce = loadSound("bounce.wav");
 	if( bounce == NULL )
 	{
 		printf( "Failed to load low sound effect! SDL_mixer Error: %s\n", Mix_GetError() );
@@ -498,63 +709,211 @@ bool loadMedia()
 	}
 
     //Load sound effect
-	breaking = Mix_LoadWAV("break.wav");
+	breaking = loadSound("break.wav");
 	if( breaking == NULL )
 	{
 		printf("Failed to load high sound effect! SDL_mixer Error: %s\n", Mix_GetError());
 		success = false;
 	}
 
+    return success;
+}
+
+int loadText(void*)
+{
+    traceThreadName("text loader");
+    TRACE_SCOPE("loadText");
+
+    //Initialize SDL_ttf
+    if( TTF_Init() == -1 )
+    {
+        printf( "SDL_ttf could not initialize! SDL_ttf Error: %s\n", TTF_GetError() );
+        return 0;
+    }
+
 	 //Open the font
-    gFont = TTF_OpenFont("Rabbit On The Moon.ttf", 28);
+    gFont = loadFont("Rabbit On The Moon.ttf", 28);
     if(gFont == NULL)
     {
         printf("Failed to load lazy font! SDL_ttf Error: %s\n", TTF_GetError());
-        success = false;
+        return 0;
     }
-    else
+
+    //Rasterize the label glyphs once; the render thread uploads and publishes them after waiting for this thread
+    if(!gTextAtlas.rasterize(gFont))
     {
-        //Render score label
-        SDL_Color textColor = { 0, 0, 0 };
+        printf("Failed to build glyph atlas!\n");
+        return 0;
+    }
 
-        if(!gScoreTexture.loadFromRenderedText(scoreText, textColor))
-        {
-            printf("Failed to render score texture!\n");
-            success = false;
-        }
-        else
-        {
-            scoreText = "Score:0";
-            gScoreTexture.loadFromRenderedText(scoreText, textColor);
-        }
+    return 1;
+}
+
+int loadImages(void*)
+{
+    traceThreadName("image loader");
+    TRACE_SCOPE("loadImages");
+
+    //Initialize PNG loading
+    int imgFlags = IMG_INIT_PNG;
+    if( !( IMG_Init( imgFlags ) & imgFlags ) )
+    {
+        printf( "SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError() );
+        return 0;
+    }
+
+    //Packed pixels need no decoding, they are uploaded straight from the archive
+    if(gAssets.find("dot.bmp") != NULL)
+    {
+        return 1;
+    }
 
-        //Render life label
-        if(!gLifeTexture.loadFromRenderedText(lifeText, textColor))
+    //Decode the loose file, the render thread uploads it
+    gDotSurface = IMG_Load("dot.bmp");
+    if(gDotSurface == NULL)
+    {
+        printf( "Unable to load image dot.bmp! SDL_image Error: %s\n", IMG_GetError() );
+        return 0;
+    }
+
+    //Color key image
+    SDL_SetColorKey( gDotSurface, SDL_TRUE, SDL_MapRGB( gDotSurface->format, 0, 0xFF, 0xFF ) );
+    return 1;
+}
+
+void startJob(LoadJob& job)
+{
+    //Run the job in place when no thread can be made
+    job.thread = SDL_CreateThread(job.function, job.name, NULL);
+    if(job.thread == NULL)
+    {
+        printf("Unable to start %s thread! SDL Error: %s\n", job.name, SDL_GetError());
+        job.result = job.function(NULL);
+    }
+}
+
+bool finishJob(LoadJob& job)
+{
+    if(job.thread != NULL)
+    {
+        SDL_WaitThread(job.thread, &job.result);
+        job.thread = NULL;
+    }
+    return job.result != 0;
+}
+
+void startLoading()
+{
+    TRACE_SCOPE("startLoading");
+
+    //Map the packed assets before the loaders look into them, loose files are used when it is missing
+    openAssets();
+
+    for(int i = 0; i < LOAD_JOB_COUNT; i++)
+    {
+        startJob(gLoadJobs[i]);
+    }
+
+    //Create the cached layers, without them every frame is drawn from scratch
+    if(!gWallLayer.create(gRenderer, SCREEN_WIDTH, SCREEN_HEIGHT, false) || !gHudLayer.create(gRenderer, SCREEN_WIDTH, SCREEN_HEIGHT, true))
+    {
+        printf("Render targets unavailable, drawing layers directly\n");
+        gWallLayer.free();
+        gHudLayer.free();
+    }
+}
+
+bool loadMedia()
+{
+	TRACE_SCOPE("loadMedia");
+
+	//Loading success flag
+	bool success = true;
+
+	//Wait for every loader, even after one failed, so none is left running
+	for(int i = 0; i < LOAD_JOB_COUNT; i++)
+	{
+	    if(!finishJob(gLoadJobs[i]))
+	    {
+	        success = false;
+	    }
+	}
+
+	//Upload press texture
+	const PackEntry* dot = gAssets.find("dot.bmp");
+	if(dot != NULL && dot->type == PACK_IMAGE)
+	{
+	    gDotTexture.loadFromPixels(gAssets.data(dot), dot->params[0], dot->params[1], dot->params[2], dot->params[3]);
+	}
+	else if(gDotSurface != NULL)
+	{
+	    gDotTexture.loadFromSurface(gDotSurface);
+	    SDL_FreeSurface(gDotSurface);
+	    gDotSurface = NULL;
+	}
+	if(gDotTexture.getWidth() == 0)
+	{
+		printf( "Failed to load dot texture!\n" );
+		success = false;
+	}
+
+    //The text loader is done with the atlas, upload the label glyphs and redraw the labels with them
+    if(gFont != NULL)
+    {
+        if(gTextAtlas.upload(gRenderer))
         {
-            printf("Failed to render life texture!\n");
-            success = false;
+            gText = &gTextAtlas;
         }
         else
         {
-            lifeText = "Lives:3";
-            gLifeTexture.loadFromRenderedText(lifeText, textColor);
+            printf("Failed to upload glyph atlas!\n");
+            success = false;
         }
+    }
+    gHudLayer.invalidate();
 
+	return success;
+}
 
-        //Render message label
-        if(!gMsgTexture.loadFromRenderedText(msgText, textColor))
-        {
-            printf("Failed to render message texture!\n");
-            success = false;
-        }
-        else
+void openAssets()
+{
+    //Look next to the executable so the working directory doesn't matter
+    char* basePath = SDL_GetBasePath();
+    string path = basePath != NULL ? string(basePath) + PACK_FILE : string(PACK_FILE);
+    SDL_free(basePath);
+
+    if(!gAssets.open(path.c_str()) && !gAssets.open(PACK_FILE))
+    {
+        printf("No asset archive, loading loose files\n");
+    }
+}
+
+Mix_Chunk* loadSound(const char* name)
+{
+    //Samples in the output format play straight from the mapping, the chunk doesn't own them
+    const PackEntry* entry = gAssets.find(name);
+    if(entry != NULL && entry->type == PACK_SOUND)
+    {
+        int frequency = 0, channels = 0;
+        Uint16 format = 0;
+        if(Mix_QuerySpec(&frequency, &format, &channels) != 0 && frequency == (int)entry->params[0] && format == entry->params[1] && channels == (int)entry->params[2])
         {
-            msgText = "Hit UP to start/pause/resume/quit";
-            gMsgTexture.loadFromRenderedText(msgText, textColor);
+            return Mix_QuickLoad_RAW((Uint8*)gAssets.data(entry), entry->size);
         }
+        printf("Audio device format differs from %s, loading loose file\n", name);
     }
+    return Mix_LoadWAV(name);
+}
 
-	return success;
+TTF_Font* loadFont(const char* name, int size)
+{
+    //The font is parsed from the mapping, no copy is made
+    const PackEntry* entry = gAssets.find(name);
+    if(entry != NULL && entry->type == PACK_RAW)
+    {
+        return TTF_OpenFontRW(gAssets.openRW(entry), 1, size);
+    }
+    return TTF_OpenFont(name, size);
 }
 
 void close()
@@ -568,13 +927,18 @@ void close()
 
 	//Free loaded images
 	gDotTexture.free();
-    gScoreTexture.free();
-    gLifeTexture.free();
+    gText = NULL;
+    gTextAtlas.free();
+    gWallLayer.free();
+    gHudLayer.free();
 
     //Free global font
     TTF_CloseFont( gFont );
     gFont = NULL;
 
+    //Nothing reads from the archive any more
+    gAssets.close();
+
 	//Destroy window
 	SDL_DestroyRenderer( gRenderer );
 	SDL_DestroyWindow( gWindow );
@@ -587,209 +951,249 @@ void close()
 	SDL_Quit();
 }
 
-bool checkCollision(SDL_Rect a, SDL_Rect b)
+void renderFrame(const GameState& prev, const GameState& cur, const uint64_t* levelAlive, double alpha)
 {
-    //The sides of the rectangles
-    int leftA, leftB;
-    int rightA, rightB;
-    int topA, topB;
-    int bottomA, bottomB;
+    //Redraw the cached layers only when a brick was destroyed or a label changed
+    if(cur.bricks != gWallLayerBricks || cur.bricksLeft != gWallLayerLeft)
+    {
+        gWallLayer.invalidate();
+        gWallLayerBricks = cur.bricks;
+        gWallLayerLeft = cur.bricksLeft;
+    }
+    if(gWallLayer.begin(gRenderer))
+    {
+        TRACE_SCOPE("wallLayer");
+        updateWall(cur, levelAlive);
+        gWallLayer.end(gRenderer);
+    }
+    if(gHudLayer.begin(gRenderer))
+    {
+        TRACE_SCOPE("hudLayer");
+        renderLabels();
+        gHudLayer.end(gRenderer);
+    }
+
+    //Render wall, or clear screen and draw it when there are no layers
+    if(gWallLayer.isValid())
+    {
+        gWallLayer.render(gRenderer);
+    }
+    else
+    {
+        SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
+        SDL_RenderClear(gRenderer);
+        updateWall(cur, levelAlive);
+    }
 
-    //Calculate the sides of rect A
-    leftA = a.x;
-    rightA = a.x + a.w;
-    topA = a.y;
-    bottomA = a.y + a.h;
+    //Render paddle
+    renderPaddle(prev.paddle, cur.paddle, alpha);
+    //Render dot
+    renderDot(prev.ball, cur.ball, alpha);
 
-    //Calculate the sides of rect B
-    leftB = b.x;
-    rightB = b.x + b.w;
-    topB = b.y;
-    bottomB = b.y + b.h;
+    //Render brick break effects over both
+    gParticles.render(gRenderer);
 
-    //If any of the sides from A are outside of B
-    if(bottomA <= topB)
+    //Render text labels
+    if(gHudLayer.isValid())
     {
-        return false;
+        gHudLayer.render(gRenderer);
+    }
+    else
+    {
+        renderLabels();
     }
+}
 
-    if(topA >= bottomB)
+void captureFrame(uint32_t tick, bool wait)
+{
+    //One frame per tick, nothing new to capture yet
+    if(!gCapture.isOpen() || tick == gCapturedTick)
     {
-        return false;
+        return;
     }
 
-    if(rightA <= leftB)
+    TRACE_SCOPE("capture");
+    uint8_t* pixels = gCapture.acquire(wait);
+    if(pixels == NULL)
     {
-        return false;
+        return;
     }
 
-    if(leftA >= rightB)
+    //Read the frame back before it is presented; conversion and writing happen on the writer thread
+    SDL_Rect screen = { 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT };
+    if(SDL_RenderReadPixels(gRenderer, &screen, SDL_PIXELFORMAT_RGBA32, pixels, SCREEN_WIDTH * 4) < 0)
     {
-        return false;
+        printf("Unable to read back frame, capture stopped! SDL Error: %s\n", SDL_GetError());
+        gCapture.submit(pixels, 0);
+        gCapture.close();
+        return;
+    }
+
+    //Ticks since the last captured frame show this frame
+    gCapture.submit(pixels, (int)(tick - gCapturedTick));
+    gCapturedTick = tick;
+}
+
+void renderMessageScreen()
+{
+    SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
+    SDL_RenderClear(gRenderer);
+
+    renderText(5, (SCREEN_HEIGHT / 2) + 20, msgText.c_str());
+}
+
+GameFlow nextFlow(GameFlow flow, const SDL_Event& e)
+{
+    //User requests quit from any screen
+    if(e.type == SDL_QUIT)
+    {
+        return FLOW_QUIT;
     }
 
-    //If none of the sides from A are outside B
-    return true;
-}
-
-//initialize the brick wall
-void initWall()
-{
-    int brick_x = 2;
-    int brick_y = 40;
-
-    int colors[5][3];
-    //red
-    colors[0][0] = 255;
-    colors[0][1] = 0;
-    colors[0][2] = 0;
-    //orange
-    colors[1][0] = 255;
-    colors[1][1] = 144;
-    colors[1][2] = 0;
-    //green
-    colors[2][0] = 0;
-    colors[2][1] = 128;
-    colors[2][2] = 0;
-    //yellow
-    colors[3][0] = 255;
-    colors[3][1] = 255;
-    colors[3][2] = 0;
-    //blue
-    colors[4][0] = 0;
-    colors[4][1] = 0;
-    colors[4][2] = 255;
-
-    for (int row = 0; row < ROWS; row++)
-    {
-        for (int col = 0; col < COLS; col++, brick_x += 40)
+    //UP starts, pauses and resumes the game, and quits from the end screens
+    if(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_UP)
+    {
+        switch(flow)
         {
-            SDL_Rect fillRect = { brick_x, brick_y, SCREEN_WIDTH / 11, 10};
-            SDL_SetRenderDrawColor( gRenderer, colors[row][0], colors[row][1], colors[row][2], 255 );
-            SDL_RenderFillRect( gRenderer, &fillRect );
-            bricks[row][col] = fillRect;
+            case FLOW_TITLE: return FLOW_PLAYING;
+            case FLOW_PLAYING: return FLOW_PAUSED;
+            case FLOW_PAUSED: return FLOW_PLAYING;
+            case FLOW_GAME_OVER: return FLOW_QUIT;
+            case FLOW_WON: return FLOW_QUIT;
+            default: break;
         }
-        // reset x position for each row
-        brick_y += 20;
-        brick_x = 2;
     }
+
+    return flow;
 }
 
-//check if the dot collided with any of the bricks of the wall
-bool handleCollision(SDL_Rect c, Paddle p)
+void recordFrameTime(double ms)
 {
-    bool collided = false;
-    //checking dot and paddle collision
-    collided = checkCollision(c, p.pCollider);
-    //return if collided
-    if(collided)
+    //Drop the oldest frame from its bucket once the history is full
+    if(gFrameTimeCount == FRAME_HISTORY)
     {
-        //play bounce sound
-        Mix_PlayChannel(-1, bounce, 0);
-        return collided;
+        gFrameBuckets[min((int)gFrameTimes[gFrameTimeNext], FRAME_BUCKETS - 1)]--;
     }
-
-    //checking dot and wall for each brick
-    for(int row = 0; row < ROWS; row++)
+    else
     {
-        for(int col = 0; col < COLS; col++)
-        {
-            //check collision only if the current brick position has dimensions more than zero
-            if(bricks[row][col].w > 0 && bricks[row][col].h > 0)
-                collided = checkCollision(c, bricks[row][col]);
+        gFrameTimeCount++;
+    }
 
-            //If collided, set the collided brick's dimensions to zero
-            if(collided)
-            {
-                //play break sound
-                Mix_PlayChannel(-1, breaking, 0);
+    gFrameTimes[gFrameTimeNext] = ms;
+    gFrameBuckets[min((int)ms, FRAME_BUCKETS - 1)]++;
+    gFrameTimeNext = (gFrameTimeNext + 1) % FRAME_HISTORY;
+}
 
-                //increase the score depending on the row number
-                switch(row)
-                {
-                    case 4 :
-                        score += 1;
-                        break;
-                    case 3 :
-                        score += 2;
-                        break;
-                    case 2 :
-                        score += 3;
-                        break;
-                    case 1 :
-                        score += 4;
-                        break;
-                    case 0 :
-                        score += 5;
-                        break;
-                }
+void renderFrameTimes()
+{
+    if(gFrameTimeCount == 0)
+    {
+        return;
+    }
 
-                //concatenate score text and score, updating the score label
-                stringstream sstm;
-                scoreText = "Score:";
-                sstm << scoreText << score;
-                scoreText = sstm.str();
-                SDL_Color textColor = {0, 0, 0};
-                gScoreTexture.loadFromRenderedText(scoreText, textColor);
-
-                //destroy the collided brick
-                bricks[row][col].w = 0;
-                bricks[row][col].h = 0;
-                brick--;
-                return collided;
-            }
-        }
+    //Panel above the paddle, one bar per millisecond bucket
+    const int barWidth = 5;
+    const int graphHeight = 60;
+    SDL_Rect panel = { 5, SCREEN_HEIGHT - 150, FRAME_BUCKETS * barWidth + 10, graphHeight + 50 };
+    SDL_SetRenderDrawBlendMode(gRenderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xC0);
+    SDL_RenderFillRect(gRenderer, &panel);
+    SDL_SetRenderDrawBlendMode(gRenderer, SDL_BLENDMODE_NONE);
+
+    int tallest = 1;
+    for(int i = 0; i < FRAME_BUCKETS; i++)
+    {
+        tallest = max(tallest, gFrameBuckets[i]);
     }
-    return collided;
-}
-
-void updateWall()
-{
-    int brick_x = 2;
-    int brick_y = 40;
-
-    int colors[5][3];
-    //red
-    colors[0][0] = 255;
-    colors[0][1] = 0;
-    colors[0][2] = 0;
-    //orange
-    colors[1][0] = 255;
-    colors[1][1] = 144;
-    colors[1][2] = 0;
-    //yellow
-    colors[2][0] = 0;
-    colors[2][1] = 128;
-    colors[2][2] = 0;
-    //green
-    colors[3][0] = 255;
-    colors[3][1] = 255;
-    colors[3][2] = 0;
-    //blue
-    colors[4][0] = 0;
-    colors[4][1] = 0;
-    colors[4][2] = 255;
-
-    for (int row = 0; row < ROWS; row++)
-    {
-        for (int col = 0; col < COLS; col++, brick_x += 40)
+
+    //Green within a 60 Hz frame, orange within two, red beyond
+    int baseline = panel.y + 5 + graphHeight;
+    for(int i = 0; i < FRAME_BUCKETS; i++)
+    {
+        if(gFrameBuckets[i] > 0)
         {
-            if(bricks[row][col].w > 0 && bricks[row][col].h > 0)
+            int h = max(1, gFrameBuckets[i] * graphHeight / tallest);
+            SDL_Rect bar = { panel.x + 5 + i * barWidth, baseline - h, barWidth - 1, h };
+            if(i < 17)
+            {
+                SDL_SetRenderDrawColor(gRenderer, 0, 160, 0, 0xFF);
+            }
+            else if(i < 33)
+            {
+                SDL_SetRenderDrawColor(gRenderer, 255, 144, 0, 0xFF);
+            }
+            else
             {
-                SDL_Rect fillRect = { brick_x, brick_y, SCREEN_WIDTH / 11, 10};
-                SDL_SetRenderDrawColor( gRenderer, colors[row][0], colors[row][1], colors[row][2], 255 );
-                SDL_RenderFillRect( gRenderer, &fillRect );
+                SDL_SetRenderDrawColor(gRenderer, 255, 0, 0, 0xFF);
             }
+            SDL_RenderFillRect(gRenderer, &bar);
         }
-        // reset x position for each row
-        brick_y += 20;
-        brick_x = 2;
+    }
+
+    //Mean and worst frame of the history
+    double total = 0, worst = 0;
+    for(int i = 0; i < gFrameTimeCount; i++)
+    {
+        total += gFrameTimes[i];
+        worst = max(worst, gFrameTimes[i]);
+    }
+    char label[32];
+    snprintf(label, sizeof(label), "%.1f / %.1f ms", total / gFrameTimeCount, worst);
+    renderText(panel.x + 5, baseline + 5, label);
+}
+
+void updateWall(const GameState& state, const uint64_t* levelAlive)
+{
+    //Rebuild the batch only when a brick was destroyed, then draw it with one call per color
+    if(levelAlive != NULL)
+    {
+        gWallBatch.update(gLevel, levelAlive, state.bricksLeft);
+    }
+    else
+    {
+        gWallBatch.update(state);
+    }
+    gWallBatch.render(gRenderer);
+}
+
+void newGame(GameState& state, LevelState& level)
+{
+    if(gLevelPath != NULL)
+    {
+        initGame(state, level, gLevel, gSeed);
+    }
+    else
+    {
+        initGame(state, gSeed);
     }
 }
 
 // main
 int main(int argc, char* args[])
 {
+	//Startup times are measured from here
+	gStartTime = SDL_GetPerformanceCounter();
+
+	//Read options
+	parseArgs(argc, args);
+	traceThreadName("main");
+
+	//Read the level before anything needs it
+	if(gLevelPath != NULL && !gLevel.loadAny(gLevelPath))
+	{
+	    return 1;
+	}
+
+	//Replays run headless, no window needed
+	if(gReplayPath != NULL)
+	{
+	    return playReplay(gReplayPath);
+	}
+
+	//Recording of this session
+	ReplayRecorder recorder;
+	recorder.begin(gSeed, gLevelPath != NULL ? &gLevel : NULL);
+
 	//Start up SDL and create window
 	if( !init() )
 	{
@@ -797,187 +1201,294 @@ int main(int argc, char* args[])
 	}
 	else
 	{
-		//Load media
+		//Load media in the background, showing the wall while it loads
+		startLoading();
+		{
+		    GameState firstGame;
+		    LevelState firstLevel;
+		    newGame(firstGame, firstLevel);
+		    renderFrame(firstGame, firstGame, gLevelPath != NULL ? firstLevel.alive.data() : NULL, 0);
+		    SDL_RenderPresent(gRenderer);
+		}
+		double firstFrameTime = (double)(SDL_GetPerformanceCounter() - gStartTime) * 1000 / SDL_GetPerformanceFrequency();
+
+		//Wait for the loaders
 		if(!loadMedia())
 		{
 			printf("Failed to load media!\n");
 		}
 		else
 		{
-			//Main loop flags
-			bool quit = false;
-            bool pause = true;
-
-			//Event handler
-			SDL_Event e1, e2;
-
-			//Initialize dot and paddle
-			Dot dot;
-            Paddle paddle;
-
-            //Clear screen
-            SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-            SDL_RenderClear(gRenderer);
-
-            initWall();
+			//Current screen
+			GameFlow flow = FLOW_TITLE;
 
-            //Render the paddle
-            paddle.render();
+			//Score pop ups are drawn from the label glyphs
+			gParticles.setAtlas(gText);
 
-            //Render dot
-            dot.render();
+			//Event handler
+			SDL_Event e;
+
+			//Initialize the game and the paddle direction
+			GameState game;
+			LevelState level;
+			newGame(game, level);
+			PaddleKeys keys = { false, false };
+			int heldDir = 0;
+
+			//Run the simulation on its own thread, paused until the game starts
+			SimThread sim;
+			sim.start(game, &recorder, gLevelPath != NULL ? &level : NULL);
+
+			//Snapshot drawn last, and the event totals already played
+			const Snapshot* shown = &sim.latest();
+			uint32_t playedBounces = shown->bounces;
+			uint32_t playedBreaks = shown->breaks;
+			uint32_t playedLivesLost = shown->livesLost;
+
+			//Bricks standing at the start, nothing has burst yet
+			gParticleBricks = shown->state.bricks;
+			gParticleAlive = shown->levelAlive;
+
+			//Paddle input changes already measured, and the synthetic presses of the latency probe
+			uint32_t measuredInputs = shown->inputs;
+			Uint32 nextProbe = 0;
+			int probeStep = 0;
+
+			//Start of the previous game frame, 0 after a pause
+			Uint64 lastFrameStart = 0;
+
+			//Capture from the first tick, the game goes on without it if the file can't be made
+			if(gCapturePath != NULL)
+			{
+			    gCapture.open(gCapturePath, SCREEN_WIDTH, SCREEN_HEIGHT, TICKS_PER_SECOND);
+			    gCapturedTick = game.tick;
+			}
 
-            //Render text labels
-            gScoreTexture.render(5, 5);
-            gLifeTexture.render(320, 5);
-            gMsgTexture.render(5, (SCREEN_HEIGHT/2) + 20);
+            //Render the first frame with labels and dot
+            renderFrame(game, game, gLevelPath != NULL ? level.alive.data() : NULL, 0);
 
             //Update screen
             SDL_RenderPresent(gRenderer);
 
-			//keep checking for key press while pause is true
-            while(pause && !quit)
-            {
-                while(SDL_PollEvent(&e1) !=0)
+            //Report how long the window took to show something and to take input
+            double interactiveTime = (double)(SDL_GetPerformanceCounter() - gStartTime) * 1000 / SDL_GetPerformanceFrequency();
+            printf("Time to first frame %.1f ms, time to interactive %.1f ms\n", firstFrameTime, interactiveTime);
+
+			//Main loop
+			while(flow != FLOW_QUIT)
+			{
+			    //Idle screens block until the next event instead of spinning
+			    if(flow != FLOW_PLAYING)
+			    {
+			        if(SDL_WaitEvent(&e) == 0)
+			        {
+			            printf("Failed to wait for events! SDL Error: %s\n", SDL_GetError());
+			            flow = FLOW_QUIT;
+			            continue;
+			        }
+
+			        //Render target contents are lost, redraw the layers
+			        if(e.type == SDL_RENDER_TARGETS_RESET || e.type == SDL_RENDER_DEVICE_RESET)
+			        {
+			            gWallLayer.invalidate();
+			            gHudLayer.invalidate();
+			        }
+
+			        GameFlow next = nextFlow(flow, e);
+			        if(next == FLOW_PLAYING)
+			        {
+			            //Keys may have changed while the game waited, go on from what is held now
+			            const Uint8* keyboard = SDL_GetKeyboardState(NULL);
+			            keys.left = keyboard[SDL_SCANCODE_LEFT] != 0;
+			            keys.right = keyboard[SDL_SCANCODE_RIGHT] != 0;
+			            if(paddleDirection(keys) != heldDir)
+			            {
+			                heldDir = paddleDirection(keys);
+			                sim.send(SIM_PADDLE_HOLD, heldDir);
+			            }
+
+			            //Restart the simulation clock
+			            sim.send(SIM_RESUME);
+			            lastFrameStart = 0;
+			        }
+			        else if(next == flow && (e.type == SDL_WINDOWEVENT || e.type == SDL_RENDER_TARGETS_RESET || e.type == SDL_RENDER_DEVICE_RESET))
+			        {
+			            //Repaint the idle screen after the window was uncovered or the targets were lost
+			            if(flow == FLOW_GAME_OVER || flow == FLOW_WON)
+			            {
+			                renderMessageScreen();
+			            }
+			            else
+			            {
+			                renderFrame(shown->prev, shown->state, gLevelPath != NULL ? shown->levelAlive.data() : NULL, 1);
+			            }
+			            SDL_RenderPresent(gRenderer);
+			        }
+			        flow = next;
+			        continue;
+			    }
+
+                TRACE_SCOPE("frame");
+                Uint64 frameStart = SDL_GetPerformanceCounter();
+
+                //Time from the start of the last frame to this one, vsync wait included
+                float frameSeconds = 0;
+                if(lastFrameStart != 0)
                 {
-                    //Start the game if UP key is pressed
-                    if(e1.type == SDL_KEYDOWN && e1.key.keysym.sym == SDLK_UP)
-                    {
-                        pause = false;
-                    }
+                    double frameMs = (double)(frameStart - lastFrameStart) * 1000 / SDL_GetPerformanceFrequency();
+                    recordFrameTime(frameMs);
+                    frameSeconds = (float)min(frameMs / 1000, 0.1);
+                }
+                lastFrameStart = frameStart;
 
-                    //quit the game from paused state
-                    if(e1.type == SDL_QUIT)
+                //Handle events on queue, stopping at the first one that leaves the game screen
+                {
+                    TRACE_SCOPE("events");
+                    if(gLatencyProbe)
                     {
-                        quit = true;
+                        pushLatencyProbe(nextProbe, probeStep);
                     }
-                }
-            }
 
-			//Main game loop
-			while(!quit && brick > 0 && lives > 0)
-			{
-                //Handle events on queue
-				while(SDL_PollEvent(&e1 ) != 0)
-				{
-                    //User requests quit
-					if(e1.type == SDL_QUIT)
+					while(flow == FLOW_PLAYING && SDL_PollEvent(&e) != 0)
 					{
-						quit = true;
-					}
-
-                    //Pause if the player press UP key
-					if(e1.type == SDL_KEYDOWN && e1.key.keysym.sym == SDLK_UP)
-                    {
-                        pause = true;
-                    }
+                        //Toggle the frame time histogram
+                        if(e.type == SDL_KEYDOWN && e.key.repeat == 0 && e.key.keysym.sym == SDLK_F3)
+                        {
+                            gShowFrameTimes = !gShowFrameTimes;
+                        }
 
-                    //keep checking for key press while pause is true
-                    while(pause && !quit)
-                    {
-                        while(SDL_PollEvent(&e2) !=0)
+                        //Render target contents are lost, redraw the layers
+                        if(e.type == SDL_RENDER_TARGETS_RESET || e.type == SDL_RENDER_DEVICE_RESET)
                         {
-                            //resume the game if UP key is pressed again
-                            if(e2.type == SDL_KEYDOWN && e2.key.keysym.sym == SDLK_UP)
-                            {
-                                pause = false;
-                            }
+                            gWallLayer.invalidate();
+                            gHudLayer.invalidate();
+                        }
 
-                            //quit the game from paused state
-                             if(e2.type == SDL_QUIT)
+                        //Track the LEFT and RIGHT keys, the simulation samples the direction they hold on every tick
+                        if(handlePaddleEvent(e, keys))
+						{
+                            heldDir = paddleDirection(keys);
+                            if(!sim.send(SIM_PADDLE_HOLD, heldDir, eventTime(e)))
                             {
-                                quit = true;
+                                printf("Input queue full, dropping paddle input\n");
                             }
-                        }
-                    }
+						}
 
-                    //move the paddle if only LEFT or RIGHT keys are pressed
-                    if(e1.key.keysym.sym == SDLK_LEFT || e1.key.keysym.sym == SDLK_RIGHT)
-					{
-					    //Handle input for the dot if LEFT or RIGHT key is pressed
-                        paddle.handleEvent(e1);
-                        paddle.move();
-					}
+						flow = nextFlow(flow, e);
+                    }
                 }
 
-				//Move the dot and check collision
-				dot.move(paddle);
-
-				//Clear screen
-				SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-				SDL_RenderClear(gRenderer);
+                //Paused or quit, stop the simulation clock and go wait for events
+                if(flow != FLOW_PLAYING)
+                {
+                    sim.send(SIM_PAUSE);
+                    continue;
+                }
 
-                //Render wall
-                updateWall();
-                //Render paddle
-                paddle.render();
-				//Render dot
-				dot.render();
+				//Take the newest tick and play sounds and update labels for everything since the last one drawn
+				shown = &sim.latest();
+				unsigned events = (shown->bounces != playedBounces ? EVENT_BOUNCE : 0)
+				                | (shown->breaks != playedBreaks ? EVENT_BREAK : 0)
+				                | (shown->livesLost != playedLivesLost ? EVENT_LIFE_LOST : 0);
+				playEvents(events, shown->state);
+				if(events & EVENT_BREAK)
+				{
+				    spawnBreakEffects(*shown);
+				}
+				gParticles.update(frameSeconds);
+				playedBounces = shown->bounces;
+				playedBreaks = shown->breaks;
+				playedLivesLost = shown->livesLost;
 
-                //Render text labels
-                gScoreTexture.render(5, 5);
-                gLifeTexture.render(320, 5);
-                gMsgTexture.render(5, (SCREEN_HEIGHT / 2) + 20);
+				//Fraction of the way from the latest tick to the next
+				double alpha = (double)(SimThread::now() - shown->tickTime) * TICKS_PER_SECOND / 1e9;
+				alpha = alpha < 0 ? 0 : alpha > 1 ? 1 : alpha;
 
-				//Update screen
-				SDL_RenderPresent(gRenderer);
+				//Show the end screen once the game is decided
+				if(gameOver(shown->state) || gameWon(shown->state))
+				{
+				    if(gameOver(shown->state))
+				    {
+				        flow = FLOW_GAME_OVER;
+				        msgText = "Game Over!, press UP key to quit";
+				    }
+				    else
+				    {
+				        flow = FLOW_WON;
+				        msgText = "Congratulations!,hit UP to quit";
+				    }
+				    renderMessageScreen();
+				    SDL_RenderPresent(gRenderer);
+				    continue;
+				}
 
-				//Wait until player presses UP key to quit the game when lives == 0
-				if(lives == 0)
-                {
-                    SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-                    SDL_RenderClear(gRenderer);
+				//Render the cached layers, paddle and dot
+				{
+				    TRACE_SCOPE("render");
+				    renderFrame(shown->prev, shown->state, gLevelPath != NULL ? shown->levelAlive.data() : NULL, alpha);
+				    if(gShowFrameTimes)
+				    {
+				        renderFrameTimes();
+				    }
+				}
 
-                    SDL_Color textColor = { 0, 0, 0 };
-                    msgText = "Game Over!, press UP key to quit";
-                    gMsgTexture.loadFromRenderedText(msgText, textColor);
-                    gMsgTexture.render(5, (SCREEN_HEIGHT / 2) + 20);
+				//Hand the frame to the capture writer, never waiting for it
+				captureFrame(shown->state.tick, false);
 
-                    SDL_RenderPresent(gRenderer);
+				//Update screen
+				{
+				    TRACE_SCOPE("present");
+				    SDL_RenderPresent(gRenderer);
+				}
 
-                    //keep checking for key press while quit is false
-                    while(!quit)
-                    {
-                        while(SDL_PollEvent(&e1) != 0)
-                        {
-                            //Quit the game if UP key is pressed
-                            if(e1.type == SDL_KEYDOWN && e1.key.keysym.sym == SDLK_UP)
-                            {
-                                quit = true;
-                            }
-                        }
-                    }
-                }
+				//The first frame drawn from the tick that applied an input is the one that shows it
+				if(gMeasureLatency && shown->inputs != measuredInputs)
+				{
+				    recordLatency(*shown, SimThread::now());
+				    measuredInputs = shown->inputs;
+				}
 
-                if(score == 150)
-                {
-                    SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-                    SDL_RenderClear(gRenderer);
+				//Sleep off the rest of the frame when capped without vsync
+				if(!gVsync && gFrameCap > 0)
+				{
+				    Uint64 frameLength = SDL_GetPerformanceFrequency() / gFrameCap;
+				    Uint64 elapsed = SDL_GetPerformanceCounter() - frameStart;
+				    if(elapsed < frameLength)
+				    {
+				        SDL_Delay((Uint32)((frameLength - elapsed) * 1000 / SDL_GetPerformanceFrequency()));
+				    }
+				}
+			}
 
-                    SDL_Color textColor = { 0, 0, 0 };
-                    msgText = "Congratulations!,hit UP to quit";
-                    gMsgTexture.loadFromRenderedText(msgText, textColor);
-                    gMsgTexture.render(5, (SCREEN_HEIGHT / 2) + 20);
+			//Stop the simulation before its recording is saved
+			sim.stop();
 
-                    SDL_RenderPresent(gRenderer);
+			if(gMeasureLatency)
+			{
+			    reportLatency();
+			}
 
-                    //keep checking for key press while quit is false
-                    while(!quit)
-                    {
-                        while(SDL_PollEvent(&e1) != 0)
-                        {
-                            //Quit the game if UP key is pressed
-                            if(e1.type == SDL_KEYDOWN && e1.key.keysym.sym == SDLK_UP)
-                            {
-                                quit = true;
-                            }
-                        }
-                    }
-                }
+			//Finish the video
+			if(gCapture.isOpen())
+			{
+			    gCapture.close();
+			    printf("Captured %u frames to %s, %u dropped\n", gCapture.written(), gCapturePath, gCapture.dropped());
 			}
 		}
 	}
 
+	//Save the recording of whatever was played
+	if(gRecordPath != NULL)
+	{
+	    saveReplay(gRecordPath, recorder.getReplay());
+	}
+
+	//Save the trace of the phases
+	if(gTracePath != NULL)
+	{
+	    traceWrite(gTracePath);
+	}
+
 	//Free resources and close SDL
 	close();
 
@@ -0,0 +1,241 @@
+//Brick store and the batch overlap kernel
+#include "bricks.h"
+#include "bitmath.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+BrickStore::BrickStore()
+{
+    //Initialize
+    mCount = 0;
+    mAliveCount = 0;
+
+    //Keep one padded block around so the column pointers are always valid
+    mX.resize(BRICK_BLOCK, 0);
+    mY.resize(BRICK_BLOCK, 0);
+    mW.resize(BRICK_BLOCK, 0);
+    mH.resize(BRICK_BLOCK, 0);
+    mAlive.resize(1, 0);
+    mBounds.resize(1);
+}
+
+void BrickStore::clear()
+{
+    mX.assign(BRICK_BLOCK, 0);
+    mY.assign(BRICK_BLOCK, 0);
+    mW.assign(BRICK_BLOCK, 0);
+    mH.assign(BRICK_BLOCK, 0);
+    mAlive.assign(1, 0);
+    mBounds.resize(1);
+    mCount = 0;
+    mAliveCount = 0;
+}
+
+int BrickStore::add(const Rect& r)
+{
+    //Grow by a whole block of dead bricks when the last one is full
+    if(mCount == (int)mX.size())
+    {
+        mX.resize(mCount + BRICK_BLOCK, 0);
+        mY.resize(mCount + BRICK_BLOCK, 0);
+        mW.resize(mCount + BRICK_BLOCK, 0);
+        mH.resize(mCount + BRICK_BLOCK, 0);
+        mAlive.push_back(0);
+        mBounds.push_back(r);
+    }
+
+    //The first brick of a block sets its bounds, the others grow them
+    int index = mCount++;
+    Rect& bounds = mBounds[index / BRICK_BLOCK];
+    if(index % BRICK_BLOCK == 0)
+    {
+        bounds = r;
+    }
+    else
+    {
+        int right = bounds.x + bounds.w > r.x + r.w ? bounds.x + bounds.w : r.x + r.w;
+        int bottom = bounds.y + bounds.h > r.y + r.h ? bounds.y + bounds.h : r.y + r.h;
+        bounds.x = bounds.x < r.x ? bounds.x : r.x;
+        bounds.y = bounds.y < r.y ? bounds.y : r.y;
+        bounds.w = right - bounds.x;
+        bounds.h = bottom - bounds.y;
+    }
+
+    mX[index] = r.x;
+    mY[index] = r.y;
+    mW[index] = r.w;
+    mH[index] = r.h;
+    mAlive[index >> 6] |= (uint64_t)1 << (index & 63);
+    mAliveCount++;
+    return index;
+}
+
+void BrickStore::addGrid(const BrickGrid& grid)
+{
+    for(int row = 0; row < grid.rows; row++)
+    {
+        for(int col = 0; col < grid.cols; col++)
+        {
+            add(gridRect(grid, row, col));
+        }
+    }
+}
+
+void BrickStore::destroy(int index)
+{
+    if(alive(index))
+    {
+        mAlive[index >> 6] &= ~((uint64_t)1 << (index & 63));
+        mAliveCount--;
+    }
+}
+
+bool BrickStore::alive(int index) const
+{
+    return (mAlive[index >> 6] >> (index & 63)) & 1;
+}
+
+Rect BrickStore::rect(int index) const
+{
+    Rect r = { mX[index], mY[index], mW[index], mH[index] };
+    return r;
+}
+
+int BrickStore::size() const
+{
+    return mCount;
+}
+
+int BrickStore::aliveCount() const
+{
+    return mAliveCount;
+}
+
+int BrickStore::blocks() const
+{
+    return (mCount + BRICK_BLOCK - 1) / BRICK_BLOCK;
+}
+
+uint64_t overlapBlock(const int32_t* x, const int32_t* y, const int32_t* w, const int32_t* h, const Rect& box)
+{
+    uint64_t bits = 0;
+
+#if defined(__AVX2__)
+    //Eight bricks per compare
+    const __m256i left = _mm256_set1_epi32(box.x);
+    const __m256i top = _mm256_set1_epi32(box.y);
+    const __m256i right = _mm256_set1_epi32(box.x + box.w);
+    const __m256i bottom = _mm256_set1_epi32(box.y + box.h);
+
+    for(int i = 0; i < BRICK_BLOCK; i += 8)
+    {
+        __m256i bx = _mm256_loadu_si256((const __m256i*)(x + i));
+        __m256i by = _mm256_loadu_si256((const __m256i*)(y + i));
+        __m256i bw = _mm256_loadu_si256((const __m256i*)(w + i));
+        __m256i bh = _mm256_loadu_si256((const __m256i*)(h + i));
+
+        //Overlap when each side of the box is inside the far side of the brick
+        __m256i hit = _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_add_epi32(bx, bw), left), _mm256_cmpgt_epi32(right, bx));
+        hit = _mm256_and_si256(hit, _mm256_cmpgt_epi32(_mm256_add_epi32(by, bh), top));
+        hit = _mm256_and_si256(hit, _mm256_cmpgt_epi32(bottom, by));
+
+        bits |= (uint64_t)(unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(hit)) << i;
+    }
+#elif defined(__SSE2__)
+    //Four bricks per compare
+    const __m128i left = _mm_set1_epi32(box.x);
+    const __m128i top = _mm_set1_epi32(box.y);
+    const __m128i right = _mm_set1_epi32(box.x + box.w);
+    const __m128i bottom = _mm_set1_epi32(box.y + box.h);
+
+    for(int i = 0; i < BRICK_BLOCK; i += 4)
+    {
+        __m128i bx = _mm_loadu_si128((const __m128i*)(x + i));
+        __m128i by = _mm_loadu_si128((const __m128i*)(y + i));
+        __m128i bw = _mm_loadu_si128((const __m128i*)(w + i));
+        __m128i bh = _mm_loadu_si128((const __m128i*)(h + i));
+
+        //Overlap when each side of the box is inside the far side of the brick
+        __m128i hit = _mm_and_si128(_mm_cmpgt_epi32(_mm_add_epi32(bx, bw), left), _mm_cmpgt_epi32(right, bx));
+        hit = _mm_and_si128(hit, _mm_cmpgt_epi32(_mm_add_epi32(by, bh), top));
+        hit = _mm_and_si128(hit, _mm_cmpgt_epi32(bottom, by));
+
+        bits |= (uint64_t)(unsigned)_mm_movemask_ps(_mm_castsi128_ps(hit)) << i;
+    }
+#else
+    //Scalar fallback, written branch free so the compiler can vectorise it
+    for(int i = 0; i < BRICK_BLOCK; i++)
+    {
+        uint64_t hit = (x[i] + w[i] > box.x) & (box.x + box.w > x[i]) & (y[i] + h[i] > box.y) & (box.y + box.h > y[i]);
+        bits |= hit << i;
+    }
+#endif
+
+    return bits;
+}
+
+int BrickStore::overlap(const Rect& box, uint64_t* mask) const
+{
+    //An empty store has no mask words to write
+    int count = 0;
+    int blockCount = blocks();
+    for(int b = 0; b < blockCount; b++)
+    {
+        //Skip blocks that are already cleared
+        uint64_t bits = mAlive[b];
+        if(bits != 0)
+        {
+            int first = b * BRICK_BLOCK;
+            bits &= overlapBlock(&mX[first], &mY[first], &mW[first], &mH[first], box);
+            count += popCount(bits);
+        }
+        mask[b] = bits;
+    }
+    return count;
+}
+
+int BrickStore::query(const Rect& box, int* hits, int maxHits) const
+{
+    int count = 0;
+    int blockCount = blocks();
+    for(int b = 0; b < blockCount && count < maxHits; b++)
+    {
+        //Skip blocks that are cleared or lie away from the box
+        uint64_t bits = mAlive[b];
+        if(bits == 0 || !checkCollision(box, mBounds[b]))
+        {
+            continue;
+        }
+
+        int first = b * BRICK_BLOCK;
+        bits &= overlapBlock(&mX[first], &mY[first], &mW[first], &mH[first], box);
+        for(; bits != 0 && count < maxHits; bits &= bits - 1)
+        {
+            hits[count++] = first + lowestBit(bits);
+        }
+    }
+    return count;
+}
+
+int BrickStore::firstOverlap(const Rect& box) const
+{
+    int blockCount = blocks();
+    for(int b = 0; b < blockCount; b++)
+    {
+        uint64_t bits = mAlive[b];
+        if(bits != 0 && checkCollision(box, mBounds[b]))
+        {
+            int first = b * BRICK_BLOCK;
+            bits &= overlapBlock(&mX[first], &mY[first], &mW[first], &mH[first], box);
+            if(bits != 0)
+            {
+                return first + lowestBit(bits);
+            }
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,79 @@
+//Structure of arrays brick storage for walls that are not a regular grid
+#ifndef BRICKS_H
+#define BRICKS_H
+
+#include <stdint.h>
+#include <vector>
+#include "game.h"
+
+//Bricks are tested against a box in blocks of this many, one alive word per block
+const int BRICK_BLOCK = 64;
+
+//Brick positions and sizes kept as separate columns with a packed alive bitset,
+//so a box can be tested against many bricks at once with SIMD compares
+class BrickStore
+{
+    public:
+        //Initializes an empty store
+        BrickStore();
+
+        //Removes all bricks
+        void clear();
+
+        //Adds a standing brick and returns its index
+        int add(const Rect& r);
+
+        //Adds every brick of a grid in row then column order
+        void addGrid(const BrickGrid& grid);
+
+        //Destroys a brick
+        void destroy(int index);
+
+        //Brick state
+        bool alive(int index) const;
+        Rect rect(int index) const;
+
+        //Number of bricks added and number still standing
+        int size() const;
+        int aliveCount() const;
+
+        //Tests a box against every standing brick.
+        //mask receives one bit per brick, (size() + 63) / 64 words; returns the number of hits.
+        int overlap(const Rect& box, uint64_t* mask) const;
+
+        //Finds the standing bricks overlapping a box in index order, like queryGrid.
+        //Blocks whose bounds miss the box are skipped; writes up to maxHits indices and returns how many.
+        int query(const Rect& box, int* hits, int maxHits) const;
+
+        //Returns the lowest index standing brick overlapping the box, or -1
+        int firstOverlap(const Rect& box) const;
+
+        //Columns, padded with dead bricks to a multiple of BRICK_BLOCK
+        const int32_t* xs() const { return &mX[0]; }
+        const int32_t* ys() const { return &mY[0]; }
+        const int32_t* ws() const { return &mW[0]; }
+        const int32_t* hs() const { return &mH[0]; }
+        const uint64_t* aliveMask() const { return &mAlive[0]; }
+
+    private:
+        //Number of blocks holding bricks
+        int blocks() const;
+
+        //Brick columns
+        std::vector<int32_t> mX, mY, mW, mH;
+
+        //One bit per brick, set while it stands
+        std::vector<uint64_t> mAlive;
+
+        //Box around the bricks of each block
+        std::vector<Rect> mBounds;
+
+        int mCount;
+        int mAliveCount;
+};
+
+//Overlap test of a box against one block of BRICK_BLOCK bricks starting at the given column pointers.
+//Returns a bit per brick, not yet filtered by the alive mask.
+uint64_t overlapBlock(const int32_t* x, const int32_t* y, const int32_t* w, const int32_t* h, const Rect& box);
+
+#endif
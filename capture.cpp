@@ -0,0 +1,239 @@
+//Video capture writer
+#include "capture.h"
+#include <string.h>
+
+//Clamps a converted sample to a byte
+static uint8_t toSample(int value)
+{
+    return (uint8_t)(value > 255 ? 255 : value);
+}
+
+VideoCapture::VideoCapture()
+{
+    //Initialize
+    mFile = NULL;
+    mFormat = CAPTURE_Y4M;
+    mWidth = 0;
+    mHeight = 0;
+    mStop = false;
+    mWritten = 0;
+    mDropped = 0;
+    mFailed = false;
+}
+
+VideoCapture::~VideoCapture()
+{
+    close();
+}
+
+bool VideoCapture::open(const char* path, int width, int height, int fps)
+{
+    close();
+
+    size_t length = strlen(path);
+    mFormat = length >= 4 && strcmp(path + length - 4, ".y4m") == 0 ? CAPTURE_Y4M : CAPTURE_RGB;
+    mFile = fopen(path, "wb");
+    if(mFile == NULL)
+    {
+        printf("Unable to create capture %s!\n", path);
+        return false;
+    }
+    if(mFormat == CAPTURE_Y4M && fprintf(mFile, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, fps) < 0)
+    {
+        printf("Unable to write capture %s!\n", path);
+        fclose(mFile);
+        mFile = NULL;
+        return false;
+    }
+
+    //Every allocation happens here, frames only move pointers around
+    mWidth = width;
+    mHeight = height;
+    size_t frameBytes = (size_t)width * height * 4;
+    mPool.assign(frameBytes * CAPTURE_BUFFERS, 0);
+    for(int i = 0; i < CAPTURE_BUFFERS; i++)
+    {
+        mFree.push(&mPool[frameBytes * i]);
+    }
+    int chromaW = (width + 1) / 2, chromaH = (height + 1) / 2;
+    mConverted.resize(mFormat == CAPTURE_Y4M ? (size_t)width * height + 2 * (size_t)chromaW * chromaH : (size_t)width * height * 3);
+
+    mStop = false;
+    mWritten = 0;
+    mDropped = 0;
+    mFailed = false;
+    mThread = std::thread(&VideoCapture::run, this);
+    return true;
+}
+
+bool VideoCapture::close()
+{
+    if(mFile == NULL)
+    {
+        return true;
+    }
+
+    //The writer drains the queue before it looks at the flag
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+        mFrameReady.notify_one();
+    }
+    mThread.join();
+
+    //Take back the buffers so the pool can be reused
+    uint8_t* pixels;
+    while(mFree.pop(pixels))
+    {
+    }
+
+    bool success = !mFailed && fclose(mFile) == 0;
+    if(mFailed)
+    {
+        fclose(mFile);
+    }
+    mFile = NULL;
+    if(!success)
+    {
+        printf("Failed to write the capture!\n");
+    }
+    return success;
+}
+
+bool VideoCapture::isOpen() const
+{
+    return mFile != NULL;
+}
+
+uint8_t* VideoCapture::acquire(bool wait)
+{
+    uint8_t* pixels;
+    if(mFree.pop(pixels))
+    {
+        return pixels;
+    }
+    if(!wait)
+    {
+        mDropped++;
+        return NULL;
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    while(!mFree.pop(pixels))
+    {
+        mBufferFree.wait(lock);
+    }
+    return pixels;
+}
+
+void VideoCapture::submit(uint8_t* pixels, int copies)
+{
+    //The queue has room for every buffer, so this never fails
+    CaptureFrame frame = { pixels, copies };
+    mQueued.push(frame);
+
+    //Taking the lock makes sure the writer is either still checking the queue or already waiting
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFrameReady.notify_one();
+}
+
+uint32_t VideoCapture::written() const
+{
+    return mWritten;
+}
+
+uint32_t VideoCapture::dropped() const
+{
+    return mDropped;
+}
+
+void VideoCapture::run()
+{
+    for(;;)
+    {
+        //Sleep until a frame comes, leave once none are left after a stop
+        CaptureFrame frame;
+        if(!mQueued.pop(frame))
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            while(!mQueued.pop(frame))
+            {
+                if(mStop)
+                {
+                    return;
+                }
+                mFrameReady.wait(lock);
+            }
+        }
+
+        //Keep taking frames after a failed write, so the game never waits on a dead file
+        for(int i = 0; i < frame.copies && !mFailed; i++)
+        {
+            if(writeFrame(frame.pixels))
+            {
+                mWritten++;
+            }
+            else
+            {
+                mFailed = true;
+            }
+        }
+
+        mFree.push(frame.pixels);
+        std::lock_guard<std::mutex> lock(mMutex);
+        mBufferFree.notify_one();
+    }
+}
+
+bool VideoCapture::writeFrame(const uint8_t* pixels)
+{
+    uint8_t* out = &mConverted[0];
+    if(mFormat == CAPTURE_RGB)
+    {
+        for(int i = 0; i < mWidth * mHeight; i++)
+        {
+            out[i * 3 + 0] = pixels[i * 4 + 0];
+            out[i * 3 + 1] = pixels[i * 4 + 1];
+            out[i * 3 + 2] = pixels[i * 4 + 2];
+        }
+        return fwrite(out, 1, mConverted.size(), mFile) == mConverted.size();
+    }
+
+    //Full range BT.601 as JPEG uses, luma per pixel and chroma from the average of each 2x2 block
+    int chromaW = (mWidth + 1) / 2, chromaH = (mHeight + 1) / 2;
+    uint8_t* lumaPlane = out;
+    uint8_t* cbPlane = out + mWidth * mHeight;
+    uint8_t* crPlane = cbPlane + chromaW * chromaH;
+    for(int i = 0; i < mWidth * mHeight; i++)
+    {
+        const uint8_t* p = pixels + i * 4;
+        lumaPlane[i] = (uint8_t)((77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8);
+    }
+    for(int cy = 0; cy < chromaH; cy++)
+    {
+        for(int cx = 0; cx < chromaW; cx++)
+        {
+            int r = 0, g = 0, b = 0, count = 0;
+            for(int y = cy * 2; y < cy * 2 + 2 && y < mHeight; y++)
+            {
+                for(int x = cx * 2; x < cx * 2 + 2 && x < mWidth; x++)
+                {
+                    const uint8_t* p = pixels + (y * mWidth + x) * 4;
+                    r += p[0];
+                    g += p[1];
+                    b += p[2];
+                    count++;
+                }
+            }
+            r /= count;
+            g /= count;
+            b /= count;
+
+            //Offset by 128 << 8 so the shifts never see a negative value
+            cbPlane[cy * chromaW + cx] = toSample((-43 * r - 85 * g + 128 * b + 32768 + 128) >> 8);
+            crPlane[cy * chromaW + cx] = toSample((128 * r - 107 * g - 21 * b + 32768 + 128) >> 8);
+        }
+    }
+
+    return fputs("FRAME\n", mFile) >= 0 && fwrite(out, 1, mConverted.size(), mFile) == mConverted.size();
+}
@@ -0,0 +1,102 @@
+//Video capture: frames go through a pool of reusable buffers to a background thread that converts and writes them
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "spscqueue.h"
+
+//Frame buffers in the pool; frames beyond them are dropped rather than waited for
+const int CAPTURE_BUFFERS = 8;
+
+//Slots of the queues between the game and the writer, more than there are buffers
+const int CAPTURE_QUEUE_SIZE = 16;
+
+//What the file holds
+enum CaptureFormat
+{
+    //YUV4MPEG2 with full range 4:2:0 chroma, playable and encodable by common tools
+    CAPTURE_Y4M,
+
+    //Headerless 8 bit RGB frames one after another, nothing lost
+    CAPTURE_RGB
+};
+
+//A filled buffer waiting for the writer
+struct CaptureFrame
+{
+    uint8_t* pixels;
+
+    //Times to write it, so skipped ticks keep the video in time; 0 only returns the buffer
+    int copies;
+};
+
+class VideoCapture
+{
+    public:
+        //Initializes variables
+        VideoCapture();
+
+        //Finishes the file
+        ~VideoCapture();
+
+        //Creates the file and starts the writer. Frames are width by height RGBA32 pixels shown fps times a second;
+        //paths ending in .y4m get Y4M, anything else raw RGB.
+        bool open(const char* path, int width, int height, int fps);
+
+        //Writes every queued frame, stops the writer and closes the file; false if a write failed
+        bool close();
+
+        bool isOpen() const;
+
+        //Takes a free buffer for the next frame, width * height * 4 bytes with rows width * 4 apart.
+        //Without wait, returns NULL instead of blocking when the writer holds every buffer.
+        uint8_t* acquire(bool wait);
+
+        //Hands a buffer from acquire to the writer
+        void submit(uint8_t* pixels, int copies);
+
+        //Frames written so far, and frames the game dropped because no buffer was free
+        uint32_t written() const;
+        uint32_t dropped() const;
+
+    private:
+        //Writer thread body
+        void run();
+
+        //Converts and writes one frame
+        bool writeFrame(const uint8_t* pixels);
+
+        FILE* mFile;
+        CaptureFormat mFormat;
+        int mWidth;
+        int mHeight;
+
+        //Every buffer in one allocation, made once
+        std::vector<uint8_t> mPool;
+
+        //Frames for the writer, and buffers it is done with
+        SpscQueue<CaptureFrame, CAPTURE_QUEUE_SIZE> mQueued;
+        SpscQueue<uint8_t*, CAPTURE_QUEUE_SIZE> mFree;
+
+        //Writer scratch for the converted frame
+        std::vector<uint8_t> mConverted;
+
+        //Wakes the writer for frames and the game for buffers
+        std::thread mThread;
+        std::mutex mMutex;
+        std::condition_variable mFrameReady;
+        std::condition_variable mBufferFree;
+        bool mStop;
+
+        std::atomic<uint32_t> mWritten;
+        uint32_t mDropped;
+        std::atomic<bool> mFailed;
+};
+
+#endif
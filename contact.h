@@ -0,0 +1,167 @@
+//Contact solver for a dot moving through one tick, shared by the game and the multi-ball engine
+#ifndef CONTACT_H
+#define CONTACT_H
+
+#include <float.h>
+#include <math.h>
+#include "game.h"
+
+//Contacts closer together than this in time are resolved together
+const float CONTACT_EPSILON = 1e-5f;
+
+//Bricks resolved in one contact, any more touched at the same instant are left for the next
+const int MAX_CONTACT_BRICKS = 64;
+
+//Earliest contact of a sweep, with everything touched at that same time
+struct Contact
+{
+    float time;
+    int normalX, normalY;
+
+    //Bricks touched, and whether the paddle was
+    int bricks[MAX_CONTACT_BRICKS];
+    int brickCount;
+    bool paddle;
+};
+
+//Adds a candidate contact, keeping only the earliest ones; brick is -1 for walls and the paddle
+inline void addContact(Contact& c, float time, int normalX, int normalY, int brick, bool paddle)
+{
+    if(time < c.time - CONTACT_EPSILON)
+    {
+        //Earlier than anything so far, start over
+        c.time = time;
+        c.normalX = 0;
+        c.normalY = 0;
+        c.brickCount = 0;
+        c.paddle = false;
+    }
+    else if(time > c.time + CONTACT_EPSILON)
+    {
+        return;
+    }
+
+    if(normalX != 0)
+    {
+        c.normalX = normalX;
+    }
+    if(normalY != 0)
+    {
+        c.normalY = normalY;
+    }
+    if(brick >= 0 && c.brickCount < MAX_CONTACT_BRICKS)
+    {
+        c.bricks[c.brickCount++] = brick;
+    }
+    c.paddle = c.paddle || paddle;
+}
+
+//Finds the earliest contact of a dot moving by (dx, dy) with the screen edges, the paddle and the wall.
+//Walls gives MAX_CANDIDATES, query(box, hits, maxHits) for the standing bricks under a box and rect(brick).
+template<class Walls>
+void findContact(const Ball& ball, const Paddle& paddle, const Walls& walls, float dx, float dy, Contact& c)
+{
+    c.time = FLT_MAX;
+    c.normalX = 0;
+    c.normalY = 0;
+    c.brickCount = 0;
+    c.paddle = false;
+
+    //Left, right and top edges of the screen, the bottom is open
+    if(dx < 0)
+    {
+        addContact(c, fmaxf(ball.x, 0) / -dx, 1, 0, -1, false);
+    }
+    if(dx > 0)
+    {
+        addContact(c, fmaxf(SCREEN_WIDTH - (ball.x + DOT_WIDTH), 0) / dx, -1, 0, -1, false);
+    }
+    if(dy < 0)
+    {
+        addContact(c, fmaxf(ball.y, 0) / -dy, 0, 1, -1, false);
+    }
+
+    float time;
+    int normalX, normalY;
+
+    //The paddle
+    if(sweepBox(ball.x, ball.y, DOT_WIDTH, DOT_HEIGHT, dx, dy, paddleRect(paddle), time, normalX, normalY))
+    {
+        addContact(c, time, normalX, normalY, -1, true);
+    }
+
+    //Bricks under the box swept by the dot this move, grown by a pixel to catch touching ones
+    Rect swept;
+    swept.x = (int)floorf(fminf(ball.x, ball.x + dx)) - 1;
+    swept.y = (int)floorf(fminf(ball.y, ball.y + dy)) - 1;
+    swept.w = (int)ceilf(fmaxf(ball.x, ball.x + dx) + DOT_WIDTH) + 1 - swept.x;
+    swept.h = (int)ceilf(fmaxf(ball.y, ball.y + dy) + DOT_HEIGHT) + 1 - swept.y;
+
+    int candidates[Walls::MAX_CANDIDATES];
+    int count = walls.query(swept, candidates, Walls::MAX_CANDIDATES);
+    for(int i = 0; i < count; i++)
+    {
+        Rect brick = walls.rect(candidates[i]);
+        if(sweepBox(ball.x, ball.y, DOT_WIDTH, DOT_HEIGHT, dx, dy, brick, time, normalX, normalY))
+        {
+            addContact(c, time, normalX, normalY, candidates[i], false);
+        }
+    }
+}
+
+//Moves a dot through one tick, bouncing off everything it touches in time order.
+//Walls also gives hit(brick), called for every brick touched and returning the raised GameEvent flags.
+//Returns those flags, with EVENT_BOUNCE for the paddle; what happens below the screen is up to the caller.
+template<class Walls>
+unsigned sweepDot(Ball& ball, const Paddle& paddle, Walls& walls)
+{
+    unsigned events = 0;
+    Contact c;
+
+    //Fraction of the tick still to travel
+    float remaining = 1;
+    for(int contact = 0; contact < MAX_CONTACTS && remaining > 0; contact++)
+    {
+        float dx = ball.velX * remaining;
+        float dy = ball.velY * remaining;
+
+        findContact(ball, paddle, walls, dx, dy, c);
+
+        //Nothing in the way, travel the rest of the tick
+        if(c.time > 1)
+        {
+            ball.x += dx;
+            ball.y += dy;
+            break;
+        }
+
+        //Move to the contact and bounce off every surface touched there
+        ball.x += dx * c.time;
+        ball.y += dy * c.time;
+        if(c.normalX * ball.velX < 0)
+        {
+            ball.velX = -ball.velX;
+        }
+        if(c.normalY * ball.velY < 0)
+        {
+            ball.velY = -ball.velY;
+        }
+
+        if(c.paddle)
+        {
+            events |= EVENT_BOUNCE;
+        }
+
+        //increase the score and destroy the bricks
+        for(int i = 0; i < c.brickCount; i++)
+        {
+            events |= walls.hit(c.bricks[i]);
+        }
+
+        remaining *= 1 - c.time;
+    }
+
+    return events;
+}
+
+#endif
@@ -0,0 +1,413 @@
+//Game rules: dot, paddle and brick wall
+#include "game.h"
+#include "bitmath.h"
+#include "board.h"
+#include "contact.h"
+#include "level.h"
+#include <float.h>
+#include <math.h>
+
+//Penetration in pixels still treated as touching, so float rounding after a contact can't push the dot through
+const float CONTACT_SKIN = 0.01f;
+
+//Bit of a brick in the alive mask
+static uint64_t brickBit(int row, int col)
+{
+    return (uint64_t)1 << (row * COLS + col);
+}
+
+//Scrambles the bits of a 32 bit value
+static uint32_t mix32(uint32_t v)
+{
+    v ^= v >> 16;
+    v *= 0x7FEB352Du;
+    v ^= v >> 15;
+    v *= 0x846CA68Bu;
+    v ^= v >> 16;
+    return v;
+}
+
+void initGame(GameState& state, uint32_t seed)
+{
+    //Initialize the dot offsets and velocity
+    state.ball.x = (SCREEN_WIDTH - DOT_WIDTH) / 2;
+    state.ball.y = (SCREEN_HEIGHT - DOT_HEIGHT) / 2;
+    state.ball.velX = 3.0f;
+    state.ball.velY = 3.0f;
+
+    //Other seeds launch at 1.5 to 4.5 pixels per tick sideways, either way
+    if(seed != 0)
+    {
+        uint32_t bits = mix32(seed);
+        state.ball.velX = 1.5f + (bits & 0xFF) * (3.0f / 255);
+        if(bits & 0x100)
+        {
+            state.ball.velX = -state.ball.velX;
+        }
+    }
+
+    //Initialize the paddle offsets
+    state.paddle.x = (SCREEN_WIDTH - PADDLE_WIDTH) / 2;
+    state.paddle.y = 580;
+
+    //Build the full wall
+    state.bricks = ((uint64_t)1 << BRICK_NUMBER) - 1;
+    state.bricksLeft = BRICK_NUMBER;
+
+    state.lives = START_LIVES;
+    state.score = 0;
+    state.winScore = WIN_SCORE;
+    state.tick = 0;
+}
+
+void initGame(GameState& state, LevelState& level, const Level& layout, uint32_t seed)
+{
+    initGame(state, seed);
+
+    //The level's bricks replace the classic wall
+    state.bricks = 0;
+    state.bricksLeft = layout.breakableCount();
+    state.winScore = layout.winScore();
+
+    level.level = &layout;
+    level.alive.assign((layout.size() + 63) / 64, 0);
+    level.hitsLeft.resize(layout.size());
+    for(int i = 0; i < layout.size(); i++)
+    {
+        level.alive[i >> 6] |= (uint64_t)1 << (i & 63);
+        level.hitsLeft[i] = layout.hits(i);
+    }
+}
+
+bool checkCollision(const Rect& a, const Rect& b)
+{
+    //If any of the sides from A are outside of B
+    if(a.y + a.h <= b.y)
+    {
+        return false;
+    }
+
+    if(a.y >= b.y + b.h)
+    {
+        return false;
+    }
+
+    if(a.x + a.w <= b.x)
+    {
+        return false;
+    }
+
+    if(a.x >= b.x + b.w)
+    {
+        return false;
+    }
+
+    //If none of the sides from A are outside B
+    return true;
+}
+
+Rect ballRect(const Ball& ball)
+{
+    Rect r = { (int)floorf(ball.x), (int)floorf(ball.y), DOT_WIDTH, DOT_HEIGHT };
+    return r;
+}
+
+Rect paddleRect(const Paddle& paddle)
+{
+    Rect r = { paddle.x, paddle.y, PADDLE_WIDTH, PADDLE_HEIGHT };
+    return r;
+}
+
+Rect brickRect(int row, int col)
+{
+    return ClassicBoard::rect(row * COLS + col);
+}
+
+Rect gridRect(const BrickGrid& grid, int row, int col)
+{
+    Rect r = { grid.originX + col * grid.pitchX, grid.originY + row * grid.pitchY, grid.brickW, grid.brickH };
+    return r;
+}
+
+int queryGrid(const BrickGrid& grid, const uint64_t* alive, const Rect& box, int* hits, int maxHits)
+{
+    //Cells whose brick can reach the box: a brick at column c spans
+    //[originX + c * pitchX, originX + c * pitchX + brickW), the same for rows
+    int colMin = floorDiv(box.x - grid.originX - grid.brickW, grid.pitchX) + 1;
+    int colMax = floorDiv(box.x + box.w - grid.originX - 1, grid.pitchX);
+    int rowMin = floorDiv(box.y - grid.originY - grid.brickH, grid.pitchY) + 1;
+    int rowMax = floorDiv(box.y + box.h - grid.originY - 1, grid.pitchY);
+
+    //Clip to the wall
+    if(colMin < 0) colMin = 0;
+    if(rowMin < 0) rowMin = 0;
+    if(colMax > grid.cols - 1) colMax = grid.cols - 1;
+    if(rowMax > grid.rows - 1) rowMax = grid.rows - 1;
+
+    int count = 0;
+    for(int row = rowMin; row <= rowMax && count < maxHits; row++)
+    {
+        for(int col = colMin; col <= colMax && count < maxHits; col++)
+        {
+            int index = row * grid.cols + col;
+            if((alive[index >> 6] >> (index & 63)) & 1)
+            {
+                //The cell range is conservative when bricks are wider than their pitch
+                if(checkCollision(box, gridRect(grid, row, col)))
+                {
+                    hits[count++] = index;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+//Entry and exit times of a moving span against a static one, given the gap to close
+static void sweepAxis(float gap, float spans, float d, float& entry, float& exit)
+{
+    float speed = fabsf(d);
+    entry = gap / speed;
+    exit = (gap + spans) / speed;
+}
+
+bool sweepBox(float x, float y, float w, float h, float dx, float dy, const Rect& target, float& time, int& normalX, int& normalY)
+{
+    float entryX, exitX, entryY, exitY;
+
+    //Gap to close on each axis, negative when the spans already overlap
+    float gapX = dx > 0 ? target.x - (x + w) : x - (target.x + target.w);
+    float gapY = dy > 0 ? target.y - (y + h) : y - (target.y + target.h);
+
+    if(dx != 0)
+    {
+        sweepAxis(gapX, w + target.w, dx, entryX, exitX);
+    }
+    else
+    {
+        //Not moving on this axis, the spans must overlap for the whole move
+        if(x + w <= target.x || x >= target.x + target.w)
+        {
+            return false;
+        }
+        entryX = -FLT_MAX;
+        exitX = FLT_MAX;
+    }
+
+    if(dy != 0)
+    {
+        sweepAxis(gapY, h + target.h, dy, entryY, exitY);
+    }
+    else
+    {
+        if(y + h <= target.y || y >= target.y + target.h)
+        {
+            return false;
+        }
+        entryY = -FLT_MAX;
+        exitY = FLT_MAX;
+    }
+
+    //The boxes touch once both axes overlap, and part as soon as one stops overlapping
+    float entry = entryX > entryY ? entryX : entryY;
+    float exit = exitX < exitY ? exitX : exitY;
+    if(entry >= exit || entry > 1)
+    {
+        return false;
+    }
+
+    //Already overlapping at the start: only accept it as a contact within the skin
+    if(entry < 0)
+    {
+        float gap = entryX > entryY ? gapX : gapY;
+        if(entry == -FLT_MAX || gap < -CONTACT_SKIN)
+        {
+            return false;
+        }
+        entry = 0;
+    }
+
+    //The axis that closed last is the one hit, both on an exact corner
+    normalX = 0;
+    normalY = 0;
+    if(entryX >= entryY)
+    {
+        normalX = dx > 0 ? -1 : 1;
+    }
+    if(entryY >= entryX)
+    {
+        normalY = dy > 0 ? -1 : 1;
+    }
+
+    time = entry;
+    return true;
+}
+
+int brickScore(int row)
+{
+    return ClassicBoard::score(row * COLS);
+}
+
+bool brickAlive(const GameState& state, int row, int col)
+{
+    return (state.bricks & brickBit(row, col)) != 0;
+}
+
+//Folds a value into an FNV-1a hash
+static uint64_t hashValue(uint64_t hash, uint32_t value)
+{
+    for(int i = 0; i < 4; i++)
+    {
+        hash ^= (value >> (i * 8)) & 0xFF;
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+//Bit pattern of a float
+static uint32_t floatBits(float f)
+{
+    union { float f; uint32_t u; } bits;
+    bits.f = f;
+    return bits.u;
+}
+
+uint64_t hashState(const GameState& state)
+{
+    //Field by field, so padding never takes part
+    uint64_t hash = 0xCBF29CE484222325ull;
+    hash = hashValue(hash, floatBits(state.ball.x));
+    hash = hashValue(hash, floatBits(state.ball.y));
+    hash = hashValue(hash, floatBits(state.ball.velX));
+    hash = hashValue(hash, floatBits(state.ball.velY));
+    hash = hashValue(hash, (uint32_t)state.paddle.x);
+    hash = hashValue(hash, (uint32_t)state.paddle.y);
+    hash = hashValue(hash, (uint32_t)state.bricks);
+    hash = hashValue(hash, (uint32_t)(state.bricks >> 32));
+    hash = hashValue(hash, (uint32_t)state.lives);
+    hash = hashValue(hash, (uint32_t)state.score);
+    hash = hashValue(hash, (uint32_t)state.bricksLeft);
+    hash = hashValue(hash, state.tick);
+    return hash;
+}
+
+uint64_t hashState(const GameState& state, const LevelState& level)
+{
+    uint64_t hash = hashState(state);
+    for(size_t i = 0; i < level.alive.size(); i++)
+    {
+        hash = hashValue(hash, (uint32_t)level.alive[i]);
+        hash = hashValue(hash, (uint32_t)(level.alive[i] >> 32));
+    }
+    for(size_t i = 0; i < level.hitsLeft.size(); i++)
+    {
+        hash = hashValue(hash, (uint32_t)level.hitsLeft[i]);
+    }
+    return hash;
+}
+
+bool gameWon(const GameState& state)
+{
+    return state.score >= state.winScore;
+}
+
+bool gameOver(const GameState& state)
+{
+    return state.lives == 0;
+}
+
+//Moves the paddle one step at a time, stopping at the screen edges
+static void movePaddle(Paddle& paddle, int steps)
+{
+    int dir = steps < 0 ? -1 : 1;
+    int count = steps < 0 ? -steps : steps;
+
+    for(int i = 0; i < count; i++)
+    {
+        paddle.x += dir * PADDLE_VEL;
+
+        //If the paddle went too far to the left or right, move back
+        if((paddle.x < 0) || (paddle.x + PADDLE_WIDTH > SCREEN_WIDTH))
+        {
+            paddle.x -= dir * PADDLE_VEL;
+        }
+    }
+}
+
+//The bricks of a board as one game sees them: the classic wall, held in the state's alive mask,
+//or a loaded level, held in its LevelState. Board gives MAX_CANDIDATES, query, rect and score.
+template<class Board>
+struct BoardWalls
+{
+    GameState& state;
+    const Board& board;
+    uint64_t* alive;
+
+    //Hits left per brick, NULL when every brick breaks on its first hit
+    int32_t* hitsLeft;
+
+    static const int MAX_CANDIDATES = Board::MAX_CANDIDATES;
+
+    int query(const Rect& box, int* hits, int maxHits) const
+    {
+        return board.query(alive, box, hits, maxHits);
+    }
+
+    Rect rect(int brick) const
+    {
+        return board.rect(brick);
+    }
+
+    //Takes a hit off a brick, destroying and scoring it on its last one; unbreakable bricks only bounce
+    unsigned hit(int brick)
+    {
+        if(hitsLeft != NULL && (hitsLeft[brick] <= 0 || --hitsLeft[brick] > 0))
+        {
+            return EVENT_BOUNCE;
+        }
+        state.score += board.score(brick);
+        alive[brick >> 6] &= ~((uint64_t)1 << (brick & 63));
+        state.bricksLeft--;
+        return EVENT_BREAK;
+    }
+};
+
+//One tick against any wall
+template<class Walls>
+static unsigned stepWalls(GameState& state, Walls& walls, const GameInput& input)
+{
+    Ball& ball = state.ball;
+
+    //Move the paddle before the dot, as the event loop did
+    movePaddle(state.paddle, input.paddleMove);
+
+    //Sweep the dot along its whole path, so fast dots can't tunnel through bricks
+    unsigned events = sweepDot(ball, state.paddle, walls);
+
+    //If the dot went too far down
+    if(ball.y + DOT_HEIGHT > SCREEN_HEIGHT)
+    {
+        //reset to original position
+        ball.x = (SCREEN_WIDTH - DOT_WIDTH) / 2;
+        ball.y = (SCREEN_HEIGHT - DOT_HEIGHT) / 2;
+
+        state.lives--;
+        events |= EVENT_LIFE_LOST;
+    }
+
+    state.tick++;
+    return events;
+}
+
+unsigned step(GameState& state, const GameInput& input)
+{
+    ClassicBoard board;
+    BoardWalls<ClassicBoard> walls = { state, board, &state.bricks, NULL };
+    return stepWalls(state, walls, input);
+}
+
+unsigned step(GameState& state, LevelState& level, const GameInput& input)
+{
+    BoardWalls<Level> walls = { state, *level.level, level.alive.data(), level.hitsLeft.data() };
+    return stepWalls(state, walls, input);
+}
@@ -0,0 +1,160 @@
+//SDL-free game simulation, shared by the SDL front end and headless tools
+#ifndef GAME_H
+#define GAME_H
+
+#include <stdint.h>
+#include <type_traits>
+
+//Screen dimension constants
+const int SCREEN_WIDTH = 400;
+const int SCREEN_HEIGHT = 600;
+
+//Brick wall dimensions
+const int ROWS = 5;
+const int COLS = 10;
+const int BRICK_NUMBER = ROWS * COLS;
+
+//Score needed to win the classic wall, levels set their own
+const int WIN_SCORE = 150;
+
+//Simulation rate; the game was tuned for one step per 60 Hz frame
+const int TICKS_PER_SECOND = 60;
+
+//Number of lives at the start of a game
+const int START_LIVES = 3;
+
+//The dimensions of the dot
+const int DOT_WIDTH = 20;
+const int DOT_HEIGHT = 20;
+
+//The dimensions of the paddle
+const int PADDLE_WIDTH = 60;
+const int PADDLE_HEIGHT = 10;
+
+//Maximum axis velocity of the paddle
+const int PADDLE_VEL = 10;
+
+//Contacts the dot can resolve in one tick before the rest of its motion is dropped
+const int MAX_CONTACTS = 4;
+
+//Events raised by a simulation step, so the front end can play sounds and update labels
+enum GameEvent
+{
+    EVENT_BOUNCE = 1 << 0,
+    EVENT_BREAK = 1 << 1,
+    EVENT_LIFE_LOST = 1 << 2
+};
+
+//Axis aligned box, same layout as SDL_Rect
+struct Rect
+{
+    int x, y, w, h;
+};
+
+//Geometry of a regular brick wall
+struct BrickGrid
+{
+    //Top left corner of the first brick
+    int originX, originY;
+
+    //Distance between the corners of neighbouring bricks
+    int pitchX, pitchY;
+
+    //The dimensions of a brick
+    int brickW, brickH;
+
+    int rows, cols;
+};
+
+//The classic wall layout
+constexpr BrickGrid CLASSIC_GRID = { 2, 40, 40, 20, SCREEN_WIDTH / 11, 10, ROWS, COLS };
+
+//The dot that moves around on the screen
+struct Ball
+{
+    //The X and Y offsets of the dot, fractional after a mid-tick contact
+    float x, y;
+
+    //The velocity of the dot, in pixels per tick
+    float velX, velY;
+};
+
+//The user controlled paddle
+struct Paddle
+{
+    //The X and Y offsets of the paddle
+    int x, y;
+};
+
+//Player input for a single simulation step
+struct GameInput
+{
+    //Paddle steps to take this tick, negative moves left, positive moves right
+    int paddleMove;
+};
+
+//Complete state of one game; a plain value, so any number of games can run side by side
+struct GameState
+{
+    Ball ball;
+    Paddle paddle;
+
+    //Alive bricks, bit (row * COLS + col) is set while the brick stands
+    uint64_t bricks;
+
+    int lives;
+    int score;
+    int bricksLeft;
+
+    //Score that wins the game, set from the wall being played
+    int winScore;
+
+    //Number of steps simulated so far
+    uint32_t tick;
+};
+
+//Saving and loading a game is a plain copy of a few dozen bytes, keep it that way
+static_assert(std::is_trivially_copyable<GameState>::value, "GameState must stay trivially copyable");
+
+//Sets up a fresh game with a full wall.
+//Seed 0 launches the dot like the original game, any other seed picks a launch direction from it.
+void initGame(GameState& state, uint32_t seed = 0);
+
+//Advances the game by one tick and returns the raised GameEvent flags
+unsigned step(GameState& state, const GameInput& input);
+
+//Box collision detector
+bool checkCollision(const Rect& a, const Rect& b);
+
+//Collision box of the dot (rounded down to whole pixels), paddle and a brick of the wall
+Rect ballRect(const Ball& ball);
+Rect paddleRect(const Paddle& paddle);
+Rect brickRect(int row, int col);
+
+//Collision box of a brick of any grid
+Rect gridRect(const BrickGrid& grid, int row, int col);
+
+//Finds the standing bricks of a grid that overlap a box, in row then column order.
+//Only the cells under the box are visited, so the cost does not depend on the wall size.
+//alive packs one bit per brick (row * cols + col) into 64 bit words.
+//Writes up to maxHits brick indices to hits and returns how many were written.
+int queryGrid(const BrickGrid& grid, const uint64_t* alive, const Rect& box, int* hits, int maxHits);
+
+//Earliest time in [0, 1] at which a box moving by (dx, dy) touches a static box.
+//Returns false if they don't meet during the move or already overlap; normalX/Y point away from the static box.
+bool sweepBox(float x, float y, float w, float h, float dx, float dy, const Rect& target, float& time, int& normalX, int& normalY);
+
+//Points awarded for breaking a brick of the given row
+int brickScore(int row);
+
+//Checks if the brick at the given position is still standing
+bool brickAlive(const GameState& state, int row, int col);
+
+//Hash of everything in the state, to check that two runs agree
+uint64_t hashState(const GameState& state);
+
+//Game end conditions
+bool gameWon(const GameState& state);
+bool gameOver(const GameState& state);
+
+#endif
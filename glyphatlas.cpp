@@ -0,0 +1,267 @@
+//Glyph atlas text renderer
+#include "glyphatlas.h"
+#include <stdio.h>
+
+//Width of the atlas, glyphs are packed left to right in rows
+const int ATLAS_WIDTH = 512;
+
+GlyphAtlas::GlyphAtlas()
+{
+    //Initialize
+    mTexture = NULL;
+    mSurface = NULL;
+    mWidth = 0;
+    mHeight = 0;
+    mLineHeight = 0;
+
+    for( int i = 0; i < GLYPH_COUNT; i++ )
+    {
+        SDL_Rect empty = { 0, 0, 0, 0 };
+        mGlyphs[ i ] = empty;
+        mAdvance[ i ] = 0;
+    }
+}
+
+GlyphAtlas::~GlyphAtlas()
+{
+    //Deallocate
+    free();
+}
+
+bool GlyphAtlas::load( SDL_Renderer* renderer, TTF_Font* font )
+{
+    return rasterize( font ) && upload( renderer );
+}
+
+bool GlyphAtlas::rasterize( TTF_Font* font )
+{
+    //Get rid of preexisting atlas
+    free();
+
+    mLineHeight = TTF_FontHeight( font );
+
+    //Render each glyph once, white so it can be tinted at draw time.
+    //A one character string renders a full line high cell with the glyph already on the baseline,
+    //where a lone glyph would come back cropped to its own bounds.
+    SDL_Color white = { 0xFF, 0xFF, 0xFF, 0xFF };
+    SDL_Surface* glyphSurfaces[ GLYPH_COUNT ];
+
+    //Shelf pack the glyphs into rows of ATLAS_WIDTH
+    int penX = 0, penY = 0;
+    for( int i = 0; i < GLYPH_COUNT; i++ )
+    {
+        char text[ 2 ] = { (char)( FIRST_GLYPH + i ), '\0' };
+        glyphSurfaces[ i ] = TTF_RenderText_Solid( font, text, white );
+
+        int advance;
+        if( TTF_GlyphMetrics( font, (Uint16)text[ 0 ], NULL, NULL, NULL, NULL, &advance ) == -1 )
+        {
+            advance = 0;
+        }
+        mAdvance[ i ] = advance;
+
+        if( glyphSurfaces[ i ] != NULL )
+        {
+            int w = glyphSurfaces[ i ]->w;
+            int h = glyphSurfaces[ i ]->h < mLineHeight ? glyphSurfaces[ i ]->h : mLineHeight;
+            if( penX + w > ATLAS_WIDTH )
+            {
+                penX = 0;
+                penY += mLineHeight + 1;
+            }
+            SDL_Rect r = { penX, penY, w, h };
+            mGlyphs[ i ] = r;
+            penX += w + 1;
+        }
+    }
+
+    mWidth = ATLAS_WIDTH;
+    mHeight = penY + mLineHeight + 1;
+
+    //Blit every glyph into one transparent surface
+    bool success = true;
+    mSurface = SDL_CreateRGBSurfaceWithFormat( 0, mWidth, mHeight, 32, SDL_PIXELFORMAT_RGBA32 );
+    if( mSurface == NULL )
+    {
+        printf( "Unable to create glyph atlas surface! SDL Error: %s\n", SDL_GetError() );
+        success = false;
+    }
+    else
+    {
+        SDL_FillRect( mSurface, NULL, 0 );
+        for( int i = 0; i < GLYPH_COUNT; i++ )
+        {
+            if( glyphSurfaces[ i ] != NULL )
+            {
+                //Cells are cut to the line height so they never spill into the next shelf
+                SDL_Rect src = { 0, 0, mGlyphs[ i ].w, mGlyphs[ i ].h };
+                SDL_Rect dst = mGlyphs[ i ];
+                SDL_BlitSurface( glyphSurfaces[ i ], &src, mSurface, &dst );
+            }
+        }
+    }
+
+    //Get rid of the glyph surfaces
+    for( int i = 0; i < GLYPH_COUNT; i++ )
+    {
+        if( glyphSurfaces[ i ] != NULL )
+        {
+            SDL_FreeSurface( glyphSurfaces[ i ] );
+        }
+    }
+
+    return success;
+}
+
+bool GlyphAtlas::upload( SDL_Renderer* renderer )
+{
+    if( mSurface == NULL )
+    {
+        return false;
+    }
+
+    //Create texture from surface pixels
+    mTexture = SDL_CreateTextureFromSurface( renderer, mSurface );
+    if( mTexture == NULL )
+    {
+        printf( "Unable to create glyph atlas texture! SDL Error: %s\n", SDL_GetError() );
+    }
+    else
+    {
+        SDL_SetTextureBlendMode( mTexture, SDL_BLENDMODE_BLEND );
+    }
+
+    //The surface is no longer needed
+    SDL_FreeSurface( mSurface );
+    mSurface = NULL;
+
+    return mTexture != NULL;
+}
+
+bool GlyphAtlas::softFont( SoftFont& font ) const
+{
+    if( mSurface == NULL || SDL_LockSurface( mSurface ) < 0 )
+    {
+        return false;
+    }
+
+    //Glyphs are white, so the alpha channel is the coverage
+    font.width = mWidth;
+    font.height = mHeight;
+    font.coverage.resize( mWidth * mHeight );
+    for( int y = 0; y < mHeight; y++ )
+    {
+        const Uint8* row = (const Uint8*)mSurface->pixels + y * mSurface->pitch;
+        for( int x = 0; x < mWidth; x++ )
+        {
+            font.coverage[ y * mWidth + x ] = row[ x * 4 + 3 ];
+        }
+    }
+    SDL_UnlockSurface( mSurface );
+
+    for( int c = 0; c < SOFT_GLYPHS; c++ )
+    {
+        Rect empty = { 0, 0, 0, 0 };
+        const SDL_Rect* r = glyphRect( (char)c );
+        if( r != NULL )
+        {
+            Rect glyph = { r->x, r->y, r->w, r->h };
+            font.glyphs[ c ] = glyph;
+        }
+        else
+        {
+            font.glyphs[ c ] = empty;
+        }
+        font.advance[ c ] = glyphAdvance( (char)c );
+    }
+    return true;
+}
+
+void GlyphAtlas::free()
+{
+    //Free texture if it exists
+    if( mTexture != NULL )
+    {
+        SDL_DestroyTexture( mTexture );
+        mTexture = NULL;
+        mWidth = 0;
+        mHeight = 0;
+    }
+
+    //Free a surface that was never uploaded
+    if( mSurface != NULL )
+    {
+        SDL_FreeSurface( mSurface );
+        mSurface = NULL;
+    }
+}
+
+void GlyphAtlas::render( SDL_Renderer* renderer, int x, int y, const char* text, SDL_Color color )
+{
+    if( mTexture == NULL )
+    {
+        return;
+    }
+
+    //Tint the white glyphs once for the whole string
+    SDL_SetTextureColorMod( mTexture, color.r, color.g, color.b );
+    SDL_SetTextureAlphaMod( mTexture, color.a );
+
+    //Copy each visible glyph out of the atlas, the texture stays bound for the whole string
+    int penX = x;
+    for( const char* c = text; *c != '\0'; c++ )
+    {
+        const SDL_Rect* src = glyphRect( *c );
+        if( src == NULL )
+        {
+            continue;
+        }
+
+        if( src->w > 0 )
+        {
+            SDL_Rect dst = { penX, y, src->w, src->h };
+            SDL_RenderCopy( renderer, mTexture, src, &dst );
+        }
+
+        penX += glyphAdvance( *c );
+    }
+}
+
+int GlyphAtlas::measure( const char* text ) const
+{
+    int width = 0;
+    for( const char* c = text; *c != '\0'; c++ )
+    {
+        width += glyphAdvance( *c );
+    }
+    return width;
+}
+
+int GlyphAtlas::getHeight() const
+{
+    return mLineHeight;
+}
+
+SDL_Texture* GlyphAtlas::getTexture() const
+{
+    return mTexture;
+}
+
+const SDL_Rect* GlyphAtlas::glyphRect( char c ) const
+{
+    //Characters outside the atlas are skipped
+    if( c < FIRST_GLYPH || c > LAST_GLYPH )
+    {
+        return NULL;
+    }
+    return &mGlyphs[ c - FIRST_GLYPH ];
+}
+
+int GlyphAtlas::glyphAdvance( char c ) const
+{
+    if( c < FIRST_GLYPH || c > LAST_GLYPH )
+    {
+        return 0;
+    }
+    return mAdvance[ c - FIRST_GLYPH ];
+}
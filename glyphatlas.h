@@ -0,0 +1,68 @@
+//Font glyphs rasterized once into a single texture, so text is drawn without SDL_ttf calls
+#ifndef GLYPHATLAS_H
+#define GLYPHATLAS_H
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include "softraster.h"
+
+//Printable ASCII range held by the atlas
+const int FIRST_GLYPH = 32;
+const int LAST_GLYPH = 126;
+const int GLYPH_COUNT = LAST_GLYPH - FIRST_GLYPH + 1;
+
+class GlyphAtlas
+{
+    public:
+        //Initializes variables
+        GlyphAtlas();
+
+        //Deallocates memory
+        ~GlyphAtlas();
+
+        //Rasterizes every printable glyph of the font into the atlas texture
+        bool load( SDL_Renderer* renderer, TTF_Font* font );
+
+        //The two halves of load: rasterizing into a surface needs no renderer and may run on any thread,
+        //uploading the surface as the atlas texture must happen on the render thread
+        bool rasterize( TTF_Font* font );
+        bool upload( SDL_Renderer* renderer );
+
+        //Copies the glyph coverage for the software rasterizer; the surface only exists between rasterize and upload
+        bool softFont( SoftFont& font ) const;
+
+        //Deallocates the atlas texture and any surface not yet uploaded
+        void free();
+
+        //Draws a string with its top left corner at the given point, every glyph copied from the one atlas texture
+        void render( SDL_Renderer* renderer, int x, int y, const char* text, SDL_Color color );
+
+        //Gets the width of a string and the line height
+        int measure( const char* text ) const;
+        int getHeight() const;
+
+        //Gets the atlas texture and the source rectangle of a glyph, a line high cell drawn from the top of the line
+        SDL_Texture* getTexture() const;
+        const SDL_Rect* glyphRect( char c ) const;
+        int glyphAdvance( char c ) const;
+
+    private:
+        //The atlas texture, glyphs are white and tinted when drawn
+        SDL_Texture* mTexture;
+
+        //Rasterized atlas waiting for upload
+        SDL_Surface* mSurface;
+
+        //Atlas dimensions
+        int mWidth;
+        int mHeight;
+
+        //Line height of the font
+        int mLineHeight;
+
+        //Line high cell of each glyph with the glyph on the baseline, and its pen advance
+        SDL_Rect mGlyphs[ GLYPH_COUNT ];
+        int mAdvance[ GLYPH_COUNT ];
+};
+
+#endif
@@ -0,0 +1,22 @@
+//Video driver for runs without a display, such as the benchmarks and replay captures
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <SDL.h>
+#include <string.h>
+
+//The offscreen driver when this SDL was built with it, dummy otherwise; both give the software renderer a window.
+//The bundled SDL2.dll only has the windows and dummy drivers.
+inline const char* headlessVideoDriver()
+{
+    for(int i = 0; i < SDL_GetNumVideoDrivers(); i++)
+    {
+        if(strcmp(SDL_GetVideoDriver(i), "offscreen") == 0)
+        {
+            return "offscreen";
+        }
+    }
+    return "dummy";
+}
+
+#endif
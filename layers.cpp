@@ -0,0 +1,90 @@
+//Retained render target layers
+#include "layers.h"
+#include <stdio.h>
+
+RenderLayer::RenderLayer()
+{
+    //Initialize
+    mTexture = NULL;
+    mTransparent = false;
+    mDirty = true;
+}
+
+RenderLayer::~RenderLayer()
+{
+    //Deallocate
+    free();
+}
+
+bool RenderLayer::create( SDL_Renderer* renderer, int width, int height, bool transparent )
+{
+    //Get rid of preexisting texture
+    free();
+
+    mTexture = SDL_CreateTexture( renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height );
+    if( mTexture == NULL )
+    {
+        printf( "Unable to create layer texture! SDL Error: %s\n", SDL_GetError() );
+    }
+    else
+    {
+        SDL_SetTextureBlendMode( mTexture, transparent ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE );
+    }
+
+    mTransparent = transparent;
+    mDirty = true;
+    return mTexture != NULL;
+}
+
+void RenderLayer::free()
+{
+    //Free texture if it exists
+    if( mTexture != NULL )
+    {
+        SDL_DestroyTexture( mTexture );
+        mTexture = NULL;
+    }
+}
+
+void RenderLayer::invalidate()
+{
+    mDirty = true;
+}
+
+bool RenderLayer::begin( SDL_Renderer* renderer )
+{
+    if( !mDirty || mTexture == NULL )
+    {
+        return false;
+    }
+
+    //Draw into the layer, starting from a clear texture
+    SDL_SetRenderTarget( renderer, mTexture );
+    if( mTransparent )
+    {
+        SDL_SetRenderDrawColor( renderer, 0xFF, 0xFF, 0xFF, 0x00 );
+    }
+    else
+    {
+        SDL_SetRenderDrawColor( renderer, 0xFF, 0xFF, 0xFF, 0xFF );
+    }
+    SDL_RenderClear( renderer );
+    return true;
+}
+
+void RenderLayer::end( SDL_Renderer* renderer )
+{
+    //Back to the window
+    SDL_SetRenderTarget( renderer, NULL );
+    mDirty = false;
+}
+
+void RenderLayer::render( SDL_Renderer* renderer )
+{
+    SDL_RenderCopy( renderer, mTexture, NULL, NULL );
+}
+
+bool RenderLayer::isValid() const
+{
+    return mTexture != NULL;
+}
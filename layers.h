@@ -0,0 +1,46 @@
+//Render target layers that keep rarely changing parts of the frame between frames
+#ifndef LAYERS_H
+#define LAYERS_H
+
+#include <SDL.h>
+
+class RenderLayer
+{
+    public:
+        //Initializes variables
+        RenderLayer();
+
+        //Deallocates memory
+        ~RenderLayer();
+
+        //Creates the target texture, transparent layers are alpha blended when composited
+        bool create( SDL_Renderer* renderer, int width, int height, bool transparent );
+
+        //Deallocates the target texture
+        void free();
+
+        //Marks the contents stale so they are redrawn before the next composite
+        void invalidate();
+
+        //Redirects drawing into the layer if it is stale and returns true, the caller then redraws it and calls end()
+        bool begin( SDL_Renderer* renderer );
+        void end( SDL_Renderer* renderer );
+
+        //Copies the layer to the current render target
+        void render( SDL_Renderer* renderer );
+
+        //Checks if the layer has a texture to draw into
+        bool isValid() const;
+
+    private:
+        //The render target texture
+        SDL_Texture* mTexture;
+
+        //Whether the texture is cleared to transparent instead of white
+        bool mTransparent;
+
+        //Whether the contents must be redrawn
+        bool mDirty;
+};
+
+#endif
@@ -0,0 +1,470 @@
+//Level layouts, their text and binary forms and the brick broad phase
+#include "level.h"
+#include "bitmath.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//Bytes per brick in the binary form, one int32 per column
+const int LEVEL_BRICK_SIZE = 7 * 4;
+
+Level::Level()
+{
+    //Initialize
+    clear();
+}
+
+void Level::clear()
+{
+    mX.clear();
+    mY.clear();
+    mW.clear();
+    mH.clear();
+    mHits.clear();
+    mScore.clear();
+    mColor.clear();
+    mWinSetting = 0;
+    build();
+}
+
+int Level::add(const Rect& r, int hits, int score, uint32_t color)
+{
+    mX.push_back(r.x);
+    mY.push_back(r.y);
+    mW.push_back(r.w);
+    mH.push_back(r.h);
+    mHits.push_back(hits);
+    mScore.push_back(score);
+    mColor.push_back(color);
+    return (int)mX.size() - 1;
+}
+
+void Level::setWinScore(int score)
+{
+    mWinSetting = score;
+    build();
+}
+
+bool Level::validate() const
+{
+    int breakable = 0;
+    for(size_t i = 0; i < mX.size(); i++)
+    {
+        if(mW[i] <= 0 || mH[i] <= 0 || mX[i] < 0 || mY[i] < 0 || mW[i] > SCREEN_WIDTH - mX[i] || mH[i] > SCREEN_HEIGHT - mY[i])
+        {
+            printf("Level brick %d at %d,%d sized %dx%d is not on the screen!\n", (int)i, mX[i], mY[i], mW[i], mH[i]);
+            return false;
+        }
+        if(mHits[i] < 0)
+        {
+            printf("Level brick %d takes %d hits!\n", (int)i, mHits[i]);
+            return false;
+        }
+        if(mHits[i] > 0)
+        {
+            breakable++;
+        }
+    }
+    if(breakable == 0)
+    {
+        printf("Level has no brick that can be broken!\n");
+        return false;
+    }
+    return true;
+}
+
+void Level::build()
+{
+    int count = (int)mX.size();
+
+    //Totals
+    int total = 0;
+    mBreakable = 0;
+    for(int i = 0; i < count; i++)
+    {
+        if(mHits[i] > 0)
+        {
+            total += mScore[i];
+            mBreakable++;
+        }
+    }
+    mWinScore = mWinSetting > 0 ? mWinSetting : total;
+
+    //Bounds of the brick corners, and the largest brick
+    int minX = 0, minY = 0, maxX = 0, maxY = 0;
+    long long sizeSum = 0;
+    mMaxW = 1;
+    mMaxH = 1;
+    for(int i = 0; i < count; i++)
+    {
+        if(i == 0 || mX[i] < minX) minX = mX[i];
+        if(i == 0 || mY[i] < minY) minY = mY[i];
+        if(i == 0 || mX[i] > maxX) maxX = mX[i];
+        if(i == 0 || mY[i] > maxY) maxY = mY[i];
+        if(mW[i] > mMaxW) mMaxW = mW[i];
+        if(mH[i] > mMaxH) mMaxH = mH[i];
+        sizeSum += mW[i] > mH[i] ? mW[i] : mH[i];
+    }
+
+    //Cells about twice the typical brick, grown until there are not many more cells than bricks
+    mCellSize = count > 0 ? (int)(sizeSum * 2 / count) : LEVEL_MIN_CELL;
+    if(mCellSize < LEVEL_MIN_CELL)
+    {
+        mCellSize = LEVEL_MIN_CELL;
+    }
+    for(;;)
+    {
+        mCellsX = (maxX - minX) / mCellSize + 1;
+        mCellsY = (maxY - minY) / mCellSize + 1;
+        if((long long)mCellsX * mCellsY <= 4LL * count + 1024)
+        {
+            break;
+        }
+        mCellSize *= 2;
+    }
+    mOriginX = minX;
+    mOriginY = minY;
+
+    //Counting sort of the bricks into their cells, keeping index order within a cell
+    mCellStart.assign(mCellsX * mCellsY + 1, 0);
+    mCellBricks.resize(count);
+    for(int i = 0; i < count; i++)
+    {
+        int cell = ((mY[i] - mOriginY) / mCellSize) * mCellsX + (mX[i] - mOriginX) / mCellSize;
+        mCellStart[cell + 1]++;
+    }
+    for(int c = 0; c < mCellsX * mCellsY; c++)
+    {
+        mCellStart[c + 1] += mCellStart[c];
+    }
+    std::vector<int> fill(mCellStart.begin(), mCellStart.end() - 1);
+    for(int i = 0; i < count; i++)
+    {
+        int cell = ((mY[i] - mOriginY) / mCellSize) * mCellsX + (mX[i] - mOriginX) / mCellSize;
+        mCellBricks[fill[cell]++] = i;
+    }
+}
+
+//Parses RRGGBB or RRGGBBAA
+static bool parseColor(const char* text, uint32_t& color)
+{
+    size_t length = strlen(text);
+    if(length != 6 && length != 8)
+    {
+        return false;
+    }
+    char* end = NULL;
+    unsigned long value = strtoul(text, &end, 16);
+    if(*end != '\0')
+    {
+        return false;
+    }
+    color = length == 6 ? (uint32_t)((value << 8) | 0xFF) : (uint32_t)value;
+    return true;
+}
+
+bool Level::loadText(const char* path)
+{
+    FILE* file = fopen(path, "r");
+    if(file == NULL)
+    {
+        printf("Unable to open level %s!\n", path);
+        return false;
+    }
+
+    //Collect everything first and build the broad phase once
+    Level parsed;
+    bool success = true;
+    char line[256];
+    for(int number = 1; success && fgets(line, sizeof(line), file) != NULL; number++)
+    {
+        char command[16], colorText[16];
+        int v[11];
+        uint32_t color;
+        if(sscanf(line, " %15s", command) != 1 || command[0] == '#')
+        {
+            continue;
+        }
+
+        if(strcmp(command, "win") == 0 && sscanf(line, " %*s %d", &v[0]) == 1)
+        {
+            parsed.mWinSetting = v[0];
+        }
+        else if(strcmp(command, "brick") == 0 && sscanf(line, " %*s %d %d %d %d %d %d %15s", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], colorText) == 7
+                && v[2] > 0 && v[3] > 0 && parseColor(colorText, color))
+        {
+            parsed.mX.push_back(v[0]);
+            parsed.mY.push_back(v[1]);
+            parsed.mW.push_back(v[2]);
+            parsed.mH.push_back(v[3]);
+            parsed.mHits.push_back(v[4]);
+            parsed.mScore.push_back(v[5]);
+            parsed.mColor.push_back(color);
+        }
+        else if(strcmp(command, "grid") == 0 && sscanf(line, " %*s %d %d %d %d %d %d %d %d %d %d %15s", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8], &v[9], colorText) == 11
+                && v[4] > 0 && v[5] > 0 && parseColor(colorText, color))
+        {
+            BrickGrid grid = { v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7] };
+            for(int row = 0; row < grid.rows; row++)
+            {
+                for(int col = 0; col < grid.cols; col++)
+                {
+                    Rect r = gridRect(grid, row, col);
+                    parsed.mX.push_back(r.x);
+                    parsed.mY.push_back(r.y);
+                    parsed.mW.push_back(r.w);
+                    parsed.mH.push_back(r.h);
+                    parsed.mHits.push_back(v[8]);
+                    parsed.mScore.push_back(v[9]);
+                    parsed.mColor.push_back(color);
+                }
+            }
+        }
+        else
+        {
+            printf("Level %s line %d: can't read \"%s\"\n", path, number, command);
+            success = false;
+        }
+    }
+    fclose(file);
+
+    if(success && !parsed.validate())
+    {
+        printf("Level %s can't be played!\n", path);
+        success = false;
+    }
+    if(success)
+    {
+        *this = parsed;
+        build();
+    }
+    return success;
+}
+
+bool Level::load(const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    LevelHeader header;
+    if(size < sizeof(header))
+    {
+        printf("Level data is truncated!\n");
+        return false;
+    }
+    memcpy(&header, bytes, sizeof(header));
+    if(memcmp(header.magic, LEVEL_MAGIC, 4) != 0 || header.version != LEVEL_VERSION)
+    {
+        printf("Not a version %u level!\n", LEVEL_VERSION);
+        return false;
+    }
+    size_t count = header.brickCount;
+    if((size - sizeof(header)) / LEVEL_BRICK_SIZE < count)
+    {
+        printf("Level data is truncated!\n");
+        return false;
+    }
+
+    //Each column is one block copy
+    std::vector<int32_t>* columns[6] = { &mX, &mY, &mW, &mH, &mHits, &mScore };
+    const unsigned char* p = bytes + sizeof(header);
+    for(int c = 0; c < 6; c++)
+    {
+        columns[c]->resize(count);
+        if(count > 0)
+        {
+            memcpy(&(*columns[c])[0], p, count * 4);
+        }
+        p += count * 4;
+    }
+    mColor.resize(count);
+    if(count > 0)
+    {
+        memcpy(&mColor[0], p, count * 4);
+    }
+
+    //Nothing is indexed until the bricks are known to fit the screen
+    if(!validate())
+    {
+        clear();
+        return false;
+    }
+
+    mWinSetting = header.winScore;
+    build();
+    return true;
+}
+
+bool Level::load(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if(file == NULL)
+    {
+        printf("Unable to open level %s!\n", path);
+        return false;
+    }
+
+    //One read of the whole file, then the columns are copied out of it
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    std::vector<unsigned char> data(size > 0 ? size : 1);
+    bool success = size > 0 && fread(&data[0], 1, size, file) == (size_t)size;
+    fclose(file);
+    if(!success)
+    {
+        printf("Unable to read level %s!\n", path);
+        return false;
+    }
+    return load(&data[0], size);
+}
+
+bool Level::loadAny(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if(file == NULL)
+    {
+        printf("Unable to open level %s!\n", path);
+        return false;
+    }
+    char magic[4] = { 0 };
+    bool binary = fread(magic, 1, 4, file) == 4 && memcmp(magic, LEVEL_MAGIC, 4) == 0;
+    fclose(file);
+
+    return binary ? load(path) : loadText(path);
+}
+
+bool Level::save(const char* path) const
+{
+    FILE* file = fopen(path, "wb");
+    if(file == NULL)
+    {
+        printf("Unable to create level %s!\n", path);
+        return false;
+    }
+
+    LevelHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LEVEL_MAGIC, 4);
+    header.version = LEVEL_VERSION;
+    header.brickCount = (uint32_t)mX.size();
+    header.winScore = mWinSetting;
+    bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    const std::vector<int32_t>* columns[6] = { &mX, &mY, &mW, &mH, &mHits, &mScore };
+    for(int c = 0; c < 6 && success && !mX.empty(); c++)
+    {
+        success = fwrite(&(*columns[c])[0], 4, mX.size(), file) == mX.size();
+    }
+    if(success && !mX.empty())
+    {
+        success = fwrite(&mColor[0], 4, mX.size(), file) == mX.size();
+    }
+
+    if(fclose(file) != 0 || !success)
+    {
+        printf("Unable to write level %s!\n", path);
+        return false;
+    }
+    return true;
+}
+
+int Level::size() const
+{
+    return (int)mX.size();
+}
+
+Rect Level::rect(int index) const
+{
+    Rect r = { mX[index], mY[index], mW[index], mH[index] };
+    return r;
+}
+
+int Level::hits(int index) const
+{
+    return mHits[index];
+}
+
+int Level::score(int index) const
+{
+    return mScore[index];
+}
+
+uint32_t Level::color(int index) const
+{
+    return mColor[index];
+}
+
+int Level::winScore() const
+{
+    return mWinScore;
+}
+
+int Level::breakableCount() const
+{
+    return mBreakable;
+}
+
+uint32_t Level::checksum() const
+{
+    //FNV-1a over every column and the win setting
+    uint32_t hash = 0x811C9DC5u;
+    const std::vector<int32_t>* columns[6] = { &mX, &mY, &mW, &mH, &mHits, &mScore };
+    for(size_t i = 0; i < mX.size(); i++)
+    {
+        for(int c = 0; c < 7; c++)
+        {
+            uint32_t value = c < 6 ? (uint32_t)(*columns[c])[i] : mColor[i];
+            for(int b = 0; b < 4; b++)
+            {
+                hash ^= (value >> (b * 8)) & 0xFF;
+                hash *= 0x01000193u;
+            }
+        }
+    }
+    hash ^= (uint32_t)mWinSetting;
+    hash *= 0x01000193u;
+
+    //0 stands for the classic wall in recordings
+    return hash != 0 ? hash : 1;
+}
+
+int Level::query(const uint64_t* alive, const Rect& box, int* hits, int maxHits) const
+{
+    if(mX.empty())
+    {
+        return 0;
+    }
+
+    //A brick overlaps the box only if its corner lies less than the largest brick before the box
+    int cx0 = floorDiv(box.x - mMaxW + 1 - mOriginX, mCellSize);
+    int cy0 = floorDiv(box.y - mMaxH + 1 - mOriginY, mCellSize);
+    int cx1 = floorDiv(box.x + box.w - 1 - mOriginX, mCellSize);
+    int cy1 = floorDiv(box.y + box.h - 1 - mOriginY, mCellSize);
+
+    //Clip to the index
+    if(cx0 < 0) cx0 = 0;
+    if(cy0 < 0) cy0 = 0;
+    if(cx1 > mCellsX - 1) cx1 = mCellsX - 1;
+    if(cy1 > mCellsY - 1) cy1 = mCellsY - 1;
+
+    int count = 0;
+    for(int cy = cy0; cy <= cy1; cy++)
+    {
+        for(int cx = cx0; cx <= cx1; cx++)
+        {
+            int cell = cy * mCellsX + cx;
+            for(int k = mCellStart[cell]; k < mCellStart[cell + 1]; k++)
+            {
+                int brick = mCellBricks[k];
+                if(((alive[brick >> 6] >> (brick & 63)) & 1) && checkCollision(box, rect(brick)))
+                {
+                    if(count == maxHits)
+                    {
+                        return count;
+                    }
+                    hits[count++] = brick;
+                }
+            }
+        }
+    }
+    return count;
+}
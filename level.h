@@ -0,0 +1,132 @@
+//Data driven brick layouts, written as text and compiled to a binary form that loads with one copy per column
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "game.h"
+
+//Binary layout, little endian:
+//  LevelHeader
+//  brickCount values of each column in turn: x, y, w, h, hits, score (int32), color (uint32 0xRRGGBBAA)
+const char LEVEL_MAGIC[4] = { 'B', 'R', 'K', 'L' };
+const uint32_t LEVEL_VERSION = 1;
+
+//Candidate bricks looked at per sweep of the dot, the rest of a dense cluster is skipped
+const int LEVEL_MAX_CANDIDATES = 1024;
+
+//Broad phase cells are never smaller than this, so tiny bricks don't make a huge index
+const int LEVEL_MIN_CELL = 8;
+
+struct LevelHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t brickCount;
+
+    //Score that wins the level
+    int32_t winScore;
+
+    uint32_t reserved[4];
+};
+
+//A brick layout. Bricks taking 0 hits can't be broken and don't count towards clearing the level.
+class Level
+{
+    public:
+        //Bricks looked at per sweep of the dot, as every board gives
+        static const int MAX_CANDIDATES = LEVEL_MAX_CANDIDATES;
+
+        //Initializes an empty level
+        Level();
+
+        //Removes every brick
+        void clear();
+
+        //Adds a brick and returns its index; call build() after the last one
+        int add(const Rect& r, int hits, int score, uint32_t color);
+
+        //Sets the winning score, 0 makes it the score of every breakable brick
+        void setWinScore(int score);
+
+        //Recomputes the totals and the broad phase after bricks were added
+        void build();
+
+        //Reads the text form:
+        //  # comment
+        //  win <score>
+        //  brick <x> <y> <w> <h> <hits> <score> <RRGGBB[AA]>
+        //  grid <x> <y> <pitchX> <pitchY> <w> <h> <rows> <cols> <hits> <score> <RRGGBB[AA]>
+        bool loadText(const char* path);
+
+        //Reads the binary form from a file or from memory, such as a mapped archive entry
+        bool load(const char* path);
+        bool load(const void* data, size_t size);
+
+        //Reads the binary form if the file has the level magic, the text form otherwise
+        bool loadAny(const char* path);
+
+        //Writes the binary form
+        bool save(const char* path) const;
+
+        //Brick data
+        int size() const;
+        Rect rect(int index) const;
+        int hits(int index) const;
+        int score(int index) const;
+        uint32_t color(int index) const;
+
+        //Score that wins, and number of bricks that can be broken
+        int winScore() const;
+        int breakableCount() const;
+
+        //Checksum of the layout, recordings store it to refuse replaying on another level
+        uint32_t checksum() const;
+
+        //Finds the standing bricks overlapping a box, in cell order.
+        //alive holds one bit per brick; writes up to maxHits indices and returns how many.
+        int query(const uint64_t* alive, const Rect& box, int* hits, int maxHits) const;
+
+    private:
+        //Checks the bricks before build() indexes them: every brick has a size, lies on the screen and takes
+        //0 or more hits, and at least one can be broken, as a level without one would be won before it starts
+        bool validate() const;
+
+        //Brick columns
+        std::vector<int32_t> mX, mY, mW, mH, mHits, mScore;
+        std::vector<uint32_t> mColor;
+
+        //Winning score as set, and as used
+        int mWinSetting;
+        int mWinScore;
+        int mBreakable;
+
+        //Broad phase: bricks listed by the cell holding their top left corner, queries reach back by the largest brick
+        int mCellSize;
+        int mCellsX, mCellsY;
+        int mOriginX, mOriginY;
+        int mMaxW, mMaxH;
+        std::vector<int> mCellStart;
+        std::vector<int> mCellBricks;
+};
+
+//Per game state of a level: which bricks stand and how many hits each has left
+struct LevelState
+{
+    const Level* level;
+    std::vector<uint64_t> alive;
+    std::vector<int32_t> hitsLeft;
+};
+
+//Sets up a fresh game on a level.
+//Seed 0 launches the dot like the original game, any other seed picks a launch direction from it.
+void initGame(GameState& state, LevelState& level, const Level& layout, uint32_t seed = 0);
+
+//Advances a level game by one tick and returns the raised GameEvent flags; damaging a brick without breaking it bounces
+unsigned step(GameState& state, LevelState& level, const GameInput& input);
+
+//Hash of a level game, the level's bricks included
+uint64_t hashState(const GameState& state, const LevelState& level);
+
+#endif
@@ -0,0 +1,65 @@
+//Texture wrapper class, drawing with the global renderer and font
+#ifndef LTEXTURE_H
+#define LTEXTURE_H
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include <string>
+
+//The window renderer
+extern SDL_Renderer* gRenderer;
+
+//Globally used font
+extern TTF_Font* gFont;
+
+//Texture wrapper class
+class LTexture
+{
+	public:
+		//Initializes variables
+		LTexture();
+
+		//Deallocates memory
+		~LTexture();
+
+		//Loads image at specified path
+		bool loadFromFile( std::string path );
+
+		//Creates image from a decoded surface, which is left to the caller
+		bool loadFromSurface( SDL_Surface* surface );
+
+		//Creates image from pixels already in a texture format, uploaded without a surface
+		bool loadFromPixels( const void* pixels, int width, int height, int pitch, Uint32 format );
+
+		//Creates image from font string
+        bool loadFromRenderedText( std::string textureText, SDL_Color textColor );
+
+		//Deallocates texture
+		void free();
+
+		//Set color modulation
+		void setColor(Uint8 red, Uint8 green, Uint8 blue);
+
+		//Set blending
+		void setBlendMode(SDL_BlendMode blending);
+
+		//Set alpha modulation
+		void setAlpha(Uint8 alpha);
+
+		//Renders texture at given point
+		void render(int x, int y, SDL_Rect* clip = NULL, double angle = 0.0, SDL_Point* center = NULL, SDL_RendererFlip flip = SDL_FLIP_NONE);
+
+		//Gets image dimensions
+		int getWidth();
+		int getHeight();
+
+	private:
+		//The actual hardware texture
+		SDL_Texture* mTexture;
+
+		//Image dimensions
+		int mWidth;
+		int mHeight;
+};
+
+#endif
@@ -0,0 +1,292 @@
+//Plays versus matches between two bots over loopback UDP with rollback netcode, under injected latency, jitter and loss.
+//Each peer runs on its own thread, or in its own process with --player; at the end both must agree with each other
+//and with a plain local replay of the inputs they sent.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "rollback.h"
+#include "udplink.h"
+
+using namespace std;
+
+//How the peers play and what the network does to them
+struct NetplayOptions
+{
+    uint32_t seed;
+    uint32_t ticks;
+    int rate;
+    int port;
+    int latency;
+    int jitter;
+    float loss;
+};
+
+//One side of the match
+struct Peer
+{
+    int player;
+    RollbackSession session;
+    UdpLink link;
+
+    //Every input the bot gave, to check the match against afterwards
+    vector<int8_t> inputs;
+
+    //The match once every input was confirmed
+    VersusState final;
+    bool success;
+};
+
+//Keeps the paddle under the own dot, but now and then wanders off for a while,
+//so the remote input changes often enough to be mispredicted
+static int8_t botMove(const GameState& state, int player, uint32_t tick)
+{
+    uint32_t bits = (tick / 12 + 1) * 0x9E3779B1u ^ (uint32_t)(player + 1) * 0x85EBCA77u;
+    bits ^= bits >> 15;
+    if(bits % 4 == 0)
+    {
+        return (int8_t)((bits >> 8) % 3) - 1;
+    }
+
+    int target = (int)state.ball.x + DOT_WIDTH / 2 - PADDLE_WIDTH / 2;
+    if(state.paddle.x < target - PADDLE_VEL / 2)
+    {
+        return 1;
+    }
+    if(state.paddle.x > target + PADDLE_VEL / 2)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+//Sends everything the remote still lacks
+static void sendPacket(Peer& peer)
+{
+    RollbackPacket packet;
+    uint8_t data[ROLLBACK_PACKET_SIZE];
+    peer.session.makePacket(packet);
+    peer.link.send(data, encodePacket(packet, data));
+}
+
+//Takes every waiting packet
+static void receivePackets(Peer& peer)
+{
+    uint8_t data[UDP_MAX_PACKET];
+    RollbackPacket packet;
+    int size;
+    while((size = peer.link.receive(data, sizeof(data))) > 0)
+    {
+        if(decodePacket(data, size, packet))
+        {
+            peer.session.receive(packet);
+        }
+    }
+}
+
+//Plays one side until both sides have every input, then lingers so the remote hears that too
+static void runPeer(Peer& peer, const NetplayOptions& options)
+{
+    peer.success = false;
+    peer.session.start(peer.player, options.seed);
+    peer.inputs.clear();
+    if(!peer.link.open(options.port + peer.player, options.port + 1 - peer.player))
+    {
+        return;
+    }
+    peer.link.setConditions(options.latency, options.jitter, options.loss, options.seed * 2 + peer.player + 1);
+
+    typedef chrono::steady_clock Clock;
+    Clock::duration frame = options.rate > 0 ? Clock::duration(chrono::nanoseconds(1000000000 / options.rate)) : Clock::duration(0);
+    Clock::time_point nextTick = Clock::now();
+    Clock::time_point lastProgress = Clock::now();
+    uint32_t confirmed = 0;
+    Clock::time_point lingerEnd = Clock::time_point::max();
+    chrono::milliseconds linger(500 + 4 * (options.latency + options.jitter));
+    chrono::milliseconds resend(5);
+    Clock::time_point nextResend = Clock::now();
+
+    while(Clock::now() < lingerEnd)
+    {
+        receivePackets(peer);
+
+        //A stalled tick is tried again on the next poll
+        RollbackSession& session = peer.session;
+        if(session.tick() < options.ticks && Clock::now() >= nextTick)
+        {
+            int player = peer.player;
+            int8_t input = botMove(session.state().players[player], player, session.tick());
+            if(session.advance(input))
+            {
+                peer.inputs.push_back(input);
+                nextTick += frame;
+                sendPacket(peer);
+            }
+        }
+        peer.link.flush();
+
+        if(lingerEnd == Clock::time_point::max() && session.confirmedTicks() >= options.ticks && session.acknowledgedTicks() >= options.ticks)
+        {
+            peer.final = session.state();
+            peer.success = true;
+            lingerEnd = Clock::now() + linger;
+        }
+        //A remote that went away never confirms anything again
+        if(session.confirmedTicks() > confirmed)
+        {
+            confirmed = session.confirmedTicks();
+            lastProgress = Clock::now();
+        }
+        if(!peer.success && Clock::now() - lastProgress > chrono::seconds(10))
+        {
+            printf("Player %d gave up at tick %u with %u confirmed\n", peer.player + 1, session.tick(), session.confirmedTicks());
+            break;
+        }
+
+        //Poll a few times a frame so packets are picked up soon after they land; resend now and then
+        //so a lost packet is made up for while the game waits or after it ended
+        this_thread::sleep_for(frame / 4 > Clock::duration(chrono::milliseconds(1)) ? frame / 4 : Clock::duration(chrono::milliseconds(1)));
+        if(Clock::now() >= nextResend)
+        {
+            sendPacket(peer);
+            nextResend = Clock::now() + resend;
+        }
+    }
+
+    peer.link.close();
+}
+
+//Prints what a peer went through
+static void report(const Peer& peer)
+{
+    const RollbackSession& session = peer.session;
+    printf("Player %d: %u ticks, %u rollbacks, %u resimulated, deepest %u, %u stalls, %u desyncs, %u of %u packets dropped\n",
+           peer.player + 1, session.tick(), session.rollbacks(), session.resimulated(), session.maxDepth(), session.stalls(),
+           session.desyncs(), peer.link.dropped(), peer.link.sent());
+}
+
+int main(int argc, char* args[])
+{
+    NetplayOptions options;
+    options.seed = 1;
+    options.ticks = TICKS_PER_SECOND * 30;
+    options.rate = TICKS_PER_SECOND;
+    options.port = 27960;
+    options.latency = 50;
+    options.jitter = 10;
+    options.loss = 5;
+    int onlyPlayer = -1;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(args[i], "--seed") == 0 && i + 1 < argc)
+        {
+            options.seed = (uint32_t)strtoul(args[++i], NULL, 10);
+        }
+        else if(strcmp(args[i], "--ticks") == 0 && i + 1 < argc)
+        {
+            options.ticks = (uint32_t)strtoul(args[++i], NULL, 10);
+        }
+        //Ticks a second each peer plays, 0 as fast as the remote keeps up
+        else if(strcmp(args[i], "--rate") == 0 && i + 1 < argc)
+        {
+            options.rate = atoi(args[++i]);
+        }
+        //Player 1 listens on this port, player 2 on the next
+        else if(strcmp(args[i], "--port") == 0 && i + 1 < argc)
+        {
+            options.port = atoi(args[++i]);
+        }
+        //One way delay in milliseconds, and up to this much more at random
+        else if(strcmp(args[i], "--latency") == 0 && i + 1 < argc)
+        {
+            options.latency = atoi(args[++i]);
+        }
+        else if(strcmp(args[i], "--jitter") == 0 && i + 1 < argc)
+        {
+            options.jitter = atoi(args[++i]);
+        }
+        //Percent of packets lost
+        else if(strcmp(args[i], "--loss") == 0 && i + 1 < argc)
+        {
+            options.loss = (float)atof(args[++i]);
+        }
+        //Plays only this side, for a match between two processes
+        else if(strcmp(args[i], "--player") == 0 && i + 1 < argc)
+        {
+            onlyPlayer = atoi(args[++i]) - 1;
+            if(onlyPlayer < 0 || onlyPlayer >= VERSUS_PLAYERS)
+            {
+                printf("Players are 1 and 2\n");
+                return 1;
+            }
+        }
+        else
+        {
+            printf("Usage: %s [--seed n] [--ticks n] [--rate ticks/s] [--port n] [--latency ms] [--jitter ms] [--loss percent] [--player 1|2]\n", args[0]);
+            return 1;
+        }
+    }
+
+    printf("%u ticks at %d/s, %d ms latency, %d ms jitter, %.1f%% loss\n", options.ticks, options.rate, options.latency, options.jitter, options.loss);
+
+    Peer peers[VERSUS_PLAYERS];
+    for(int p = 0; p < VERSUS_PLAYERS; p++)
+    {
+        peers[p].player = p;
+        peers[p].success = false;
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    if(onlyPlayer >= 0)
+    {
+        runPeer(peers[onlyPlayer], options);
+        report(peers[onlyPlayer]);
+        if(!peers[onlyPlayer].success || peers[onlyPlayer].session.desyncs() != 0)
+        {
+            return 1;
+        }
+        printf("Final hash %016llx\n", (unsigned long long)hashVersus(peers[onlyPlayer].final));
+        return 0;
+    }
+
+    thread second(runPeer, ref(peers[1]), cref(options));
+    runPeer(peers[0], options);
+    second.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    bool success = true;
+    for(int p = 0; p < VERSUS_PLAYERS; p++)
+    {
+        report(peers[p]);
+        success = success && peers[p].success && peers[p].session.desyncs() == 0;
+    }
+    if(!success)
+    {
+        printf("The match did not finish cleanly!\n");
+        return 1;
+    }
+
+    //Play the inputs the bots actually gave without any network, the peers must end up on exactly that
+    VersusState local;
+    initVersus(local, options.seed);
+    for(uint32_t t = 0; t < options.ticks; t++)
+    {
+        int8_t inputs[VERSUS_PLAYERS] = { peers[0].inputs[t], peers[1].inputs[t] };
+        stepVersus(local, inputs);
+    }
+
+    uint64_t expected = hashVersus(local);
+    printf("Final hashes %016llx %016llx, local replay %016llx\n", (unsigned long long)hashVersus(peers[0].final),
+           (unsigned long long)hashVersus(peers[1].final), (unsigned long long)expected);
+    printf("Scores %d : %d, lives %d : %d, %d bricks left, in %.2f s\n", local.players[0].score, local.players[1].score,
+           local.players[0].lives, local.players[1].lives, local.players[0].bricksLeft, seconds);
+    if(hashVersus(peers[0].final) != expected || hashVersus(peers[1].final) != expected)
+    {
+        printf("The peers desynced!\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,262 @@
+//Builds the asset archive: images become RGBA pixels, sounds become PCM in the mixer's format, fonts are stored as is.
+//Also compiles text levels to their binary form.
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "assetpack.h"
+#include "level.h"
+
+using namespace std;
+
+//An entry and its data, before offsets are known
+struct PackedAsset
+{
+    PackEntry entry;
+    vector<Uint8> data;
+};
+
+//Converts a BMP to RGBA32, turning the cyan color key into transparent pixels
+bool packImage(const string& path, PackedAsset& asset)
+{
+    SDL_Surface* loadedSurface = SDL_LoadBMP(path.c_str());
+    if(loadedSurface == NULL)
+    {
+        printf("Unable to load image %s! SDL Error: %s\n", path.c_str(), SDL_GetError());
+        return false;
+    }
+
+    SDL_SetColorKey(loadedSurface, SDL_TRUE, SDL_MapRGB(loadedSurface->format, 0, 0xFF, 0xFF));
+    SDL_Surface* rgba = SDL_ConvertSurfaceFormat(loadedSurface, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(loadedSurface);
+    if(rgba == NULL)
+    {
+        printf("Unable to convert image %s! SDL Error: %s\n", path.c_str(), SDL_GetError());
+        return false;
+    }
+
+    //Rows are stored tightly packed
+    int pitch = rgba->w * 4;
+    asset.data.resize((size_t)pitch * rgba->h);
+    for(int y = 0; y < rgba->h; y++)
+    {
+        memcpy(&asset.data[(size_t)y * pitch], (const Uint8*)rgba->pixels + (size_t)y * rgba->pitch, pitch);
+    }
+
+    asset.entry.type = PACK_IMAGE;
+    asset.entry.params[0] = rgba->w;
+    asset.entry.params[1] = rgba->h;
+    asset.entry.params[2] = pitch;
+    asset.entry.params[3] = SDL_PIXELFORMAT_RGBA32;
+    SDL_FreeSurface(rgba);
+    return true;
+}
+
+//Decodes a WAV and resamples it to the mixer's output format
+bool packSound(const string& path, PackedAsset& asset)
+{
+    SDL_AudioSpec spec;
+    Uint8* buffer = NULL;
+    Uint32 length = 0;
+    if(SDL_LoadWAV(path.c_str(), &spec, &buffer, &length) == NULL)
+    {
+        printf("Unable to load sound %s! SDL Error: %s\n", path.c_str(), SDL_GetError());
+        return false;
+    }
+
+    SDL_AudioCVT cvt;
+    if(SDL_BuildAudioCVT(&cvt, spec.format, spec.channels, spec.freq, PACK_AUDIO_FORMAT, PACK_AUDIO_CHANNELS, PACK_AUDIO_FREQUENCY) < 0)
+    {
+        printf("Unable to convert sound %s! SDL Error: %s\n", path.c_str(), SDL_GetError());
+        SDL_FreeWAV(buffer);
+        return false;
+    }
+
+    //The conversion runs in place and may need more room than the input
+    asset.data.resize((size_t)length * (cvt.needed ? cvt.len_mult : 1));
+    memcpy(&asset.data[0], buffer, length);
+    SDL_FreeWAV(buffer);
+    if(cvt.needed)
+    {
+        cvt.buf = &asset.data[0];
+        cvt.len = (int)length;
+        if(SDL_ConvertAudio(&cvt) < 0)
+        {
+            printf("Unable to convert sound %s! SDL Error: %s\n", path.c_str(), SDL_GetError());
+            return false;
+        }
+        asset.data.resize(cvt.len_cvt);
+    }
+
+    asset.entry.type = PACK_SOUND;
+    asset.entry.params[0] = PACK_AUDIO_FREQUENCY;
+    asset.entry.params[1] = PACK_AUDIO_FORMAT;
+    asset.entry.params[2] = PACK_AUDIO_CHANNELS;
+    return true;
+}
+
+//Copies a file unchanged
+bool packRaw(const string& path, PackedAsset& asset)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if(file == NULL)
+    {
+        printf("Unable to open %s!\n", path.c_str());
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    asset.data.resize(size > 0 ? size : 0);
+    bool success = size > 0 && fread(&asset.data[0], 1, size, file) == (size_t)size;
+    fclose(file);
+    if(!success)
+    {
+        printf("Unable to read %s!\n", path.c_str());
+        return false;
+    }
+
+    asset.entry.type = PACK_RAW;
+    return true;
+}
+
+//Writes the header, the index and the aligned data
+bool writePack(const char* path, vector<PackedAsset>& assets)
+{
+    //Lay out the data after the index
+    uint32_t offset = sizeof(PackHeader) + sizeof(PackEntry) * assets.size();
+    for(size_t i = 0; i < assets.size(); i++)
+    {
+        offset = (offset + PACK_ALIGN - 1) / PACK_ALIGN * PACK_ALIGN;
+        assets[i].entry.offset = offset;
+        assets[i].entry.size = (uint32_t)assets[i].data.size();
+        offset += assets[i].entry.size;
+    }
+
+    FILE* file = fopen(path, "wb");
+    if(file == NULL)
+    {
+        printf("Unable to create %s!\n", path);
+        return false;
+    }
+
+    PackHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PACK_MAGIC, 4);
+    header.version = PACK_VERSION;
+    header.count = (uint32_t)assets.size();
+    fwrite(&header, sizeof(header), 1, file);
+    for(size_t i = 0; i < assets.size(); i++)
+    {
+        fwrite(&assets[i].entry, sizeof(PackEntry), 1, file);
+    }
+
+    static const Uint8 padding[PACK_ALIGN] = { 0 };
+    for(size_t i = 0; i < assets.size(); i++)
+    {
+        fwrite(padding, 1, assets[i].entry.offset - ftell(file), file);
+        fwrite(&assets[i].data[0], 1, assets[i].data.size(), file);
+    }
+
+    bool success = ferror(file) == 0;
+    fclose(file);
+    if(!success)
+    {
+        printf("Failed to write %s!\n", path);
+    }
+    return success;
+}
+
+int main(int argc, char* args[])
+{
+    const char* outPath = PACK_FILE;
+    const char* levelPath = NULL;
+    string sourceDir = "";
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(args[i], "--out") == 0 && i + 1 < argc)
+        {
+            outPath = args[++i];
+        }
+        else if(strcmp(args[i], "--dir") == 0 && i + 1 < argc)
+        {
+            sourceDir = string(args[++i]) + "/";
+        }
+        else if(strcmp(args[i], "--level") == 0 && i + 1 < argc)
+        {
+            levelPath = args[++i];
+        }
+        else
+        {
+            printf("Usage: %s [--out assets.pak] [--dir source directory]\n", args[0]);
+            printf("       %s --level level.txt --out level.lvl\n", args[0]);
+            return 1;
+        }
+    }
+
+    //Compile a level instead of packing the assets
+    if(levelPath != NULL)
+    {
+        if(outPath == PACK_FILE)
+        {
+            printf("Give the compiled level a name with --out\n");
+            return 1;
+        }
+
+        Level level;
+        if(!level.loadText(levelPath) || !level.save(outPath))
+        {
+            return 1;
+        }
+
+        printf("Compiled %d bricks into %s\n", level.size(), outPath);
+        return 0;
+    }
+
+    //Every asset the game loads
+    static const struct { const char* name; PackType type; } SOURCES[] =
+    {
+        { "dot.bmp", PACK_IMAGE },
+        { "bounce.wav", PACK_SOUND },
+        { "break.wav", PACK_SOUND },
+        { "Rabbit On The Moon.ttf", PACK_RAW }
+    };
+
+    vector<PackedAsset> assets;
+    bool success = true;
+    for(size_t i = 0; i < sizeof(SOURCES) / sizeof(SOURCES[0]); i++)
+    {
+        PackedAsset asset;
+        memset(&asset.entry, 0, sizeof(asset.entry));
+        strncpy(asset.entry.name, SOURCES[i].name, PACK_NAME_LENGTH - 1);
+
+        string path = sourceDir + SOURCES[i].name;
+        bool packed = false;
+        switch(SOURCES[i].type)
+        {
+            case PACK_IMAGE: packed = packImage(path, asset); break;
+            case PACK_SOUND: packed = packSound(path, asset); break;
+            case PACK_RAW: packed = packRaw(path, asset); break;
+        }
+
+        if(packed)
+        {
+            assets.push_back(asset);
+        }
+        else
+        {
+            success = false;
+        }
+    }
+
+    if(!success || !writePack(outPath, assets))
+    {
+        return 1;
+    }
+
+    printf("Packed %d assets into %s\n", (int)assets.size(), outPath);
+    return 0;
+}
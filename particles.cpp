@@ -0,0 +1,318 @@
+//Particle pool
+#include "particles.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+//Column length, the capacity rounded up to whole blocks of four
+static const int PARTICLE_SLOTS = (PARTICLE_CAPACITY + 3) & ~3;
+
+ParticleSystem::ParticleSystem()
+{
+    //Initialize
+    mX.resize(PARTICLE_SLOTS, 0);
+    mY.resize(PARTICLE_SLOTS, 0);
+    mVelX.resize(PARTICLE_SLOTS, 0);
+    mVelY.resize(PARTICLE_SLOTS, 0);
+    mGravity.resize(PARTICLE_SLOTS, 0);
+    mLife.resize(PARTICLE_SLOTS, 0);
+    mInvLife.resize(PARTICLE_SLOTS, 0);
+    mSize.resize(PARTICLE_SLOTS, 0);
+    mColor.resize(PARTICLE_SLOTS, 0);
+    mGlyph.resize(PARTICLE_SLOTS, 0);
+    mCount = 0;
+    mGlyphCount = 0;
+
+    mAtlas = NULL;
+    mTexture = NULL;
+
+    mRects.resize(PARTICLE_CAPACITY);
+    mKeys.resize(PARTICLE_CAPACITY);
+    mGrouped.resize(PARTICLE_CAPACITY);
+    mBucket.resize(PARTICLE_BUCKETS, 0);
+    mUsed.reserve(PARTICLE_BUCKETS);
+
+    mRandom = 0x2545F491;
+}
+
+void ParticleSystem::setAtlas(const GlyphAtlas* atlas)
+{
+    mAtlas = NULL;
+    mTexture = NULL;
+    if(atlas == NULL || atlas->getTexture() == NULL)
+    {
+        return;
+    }
+
+    mAtlas = atlas;
+    mTexture = atlas->getTexture();
+}
+
+void ParticleSystem::spawnBreak(const Rect& brick, uint32_t color, int score)
+{
+    float centerX = brick.x + brick.w * 0.5f;
+    float centerY = brick.y + brick.h * 0.5f;
+
+    //Chunks of the brick thrown up and out, then falling
+    for(int i = 0; i < BREAK_DEBRIS; i++)
+    {
+        float x = brick.x + random(0, (float)brick.w);
+        float y = brick.y + random(0, (float)brick.h);
+        spawn(x, y, (x - centerX) * 4 + random(-40, 40), random(-160, -40), 900, random(0.5f, 0.9f), random(2, 5), color, 0);
+    }
+
+    //Sparks flying every way, fast and short lived
+    for(int i = 0; i < BREAK_SPARKS; i++)
+    {
+        float angle = random(0, 6.2831853f);
+        float speed = random(120, 260);
+        spawn(centerX, centerY, cosf(angle) * speed, sinf(angle) * speed, 200, random(0.2f, 0.4f), 2, 0xFFC830FF, 0);
+    }
+
+    //The score drifting up out of the brick, unless too many pop ups are up already
+    char text[16];
+    snprintf(text, sizeof(text), "+%d", score);
+    if(mAtlas != NULL && score > 0 && mGlyphCount + (int)strlen(text) <= POPUP_GLYPH_CAPACITY)
+    {
+        float penX = centerX - mAtlas->measure(text) * 0.5f;
+        float top = centerY - mAtlas->getHeight() * 0.5f;
+        for(const char* c = text; *c != '\0'; c++)
+        {
+            spawn(penX, top, 0, -45, 0, 0.8f, 0, color | 0xFF, *c);
+            penX += mAtlas->glyphAdvance(*c);
+        }
+    }
+}
+
+bool ParticleSystem::spawn(float x, float y, float velX, float velY, float gravity, float life, float size, uint32_t color, char glyph)
+{
+    if(mCount == PARTICLE_CAPACITY || life <= 0)
+    {
+        return false;
+    }
+
+    int i = mCount++;
+    mX[i] = x;
+    mY[i] = y;
+    mVelX[i] = velX;
+    mVelY[i] = velY;
+    mGravity[i] = gravity;
+    mLife[i] = life;
+    mInvLife[i] = 1 / life;
+    mSize[i] = size;
+    mColor[i] = color;
+    mGlyph[i] = glyph;
+    if(glyph != 0)
+    {
+        mGlyphCount++;
+    }
+    return true;
+}
+
+void ParticleSystem::update(float seconds)
+{
+    if(mCount == 0)
+    {
+        return;
+    }
+
+    //Slots past the last particle in the final block are moved too, but left out of the dead check
+    int i = 0;
+    bool anyDead = false;
+#if defined(__SSE2__)
+    const __m128 dt = _mm_set1_ps(seconds);
+    const __m128 zero = _mm_setzero_ps();
+    int dead = 0;
+    for(; i < mCount; i += 4)
+    {
+        __m128 velY = _mm_add_ps(_mm_loadu_ps(&mVelY[i]), _mm_mul_ps(_mm_loadu_ps(&mGravity[i]), dt));
+        _mm_storeu_ps(&mVelY[i], velY);
+        _mm_storeu_ps(&mX[i], _mm_add_ps(_mm_loadu_ps(&mX[i]), _mm_mul_ps(_mm_loadu_ps(&mVelX[i]), dt)));
+        _mm_storeu_ps(&mY[i], _mm_add_ps(_mm_loadu_ps(&mY[i]), _mm_mul_ps(velY, dt)));
+        __m128 life = _mm_sub_ps(_mm_loadu_ps(&mLife[i]), dt);
+        _mm_storeu_ps(&mLife[i], life);
+        int lanes = _mm_movemask_ps(_mm_cmple_ps(life, zero));
+        if(mCount - i < 4)
+        {
+            lanes &= (1 << (mCount - i)) - 1;
+        }
+        dead |= lanes;
+    }
+    anyDead = dead != 0;
+#else
+    for(; i < mCount; i++)
+    {
+        mVelY[i] += mGravity[i] * seconds;
+        mX[i] += mVelX[i] * seconds;
+        mY[i] += mVelY[i] * seconds;
+        mLife[i] -= seconds;
+        anyDead = anyDead || mLife[i] <= 0;
+    }
+#endif
+
+    //Fill the gap of each particle that ran out with the last one
+    if(anyDead)
+    {
+        for(int p = 0; p < mCount; )
+        {
+            if(mLife[p] > 0)
+            {
+                p++;
+                continue;
+            }
+            if(mGlyph[p] != 0)
+            {
+                mGlyphCount--;
+            }
+            mCount--;
+            move(mCount, p);
+        }
+    }
+}
+
+//Channel of a 0xRRGGBBAA color rounded to 4 bits, and back
+static int toNibble(int value)
+{
+    return (value + 8) / 17;
+}
+
+static Uint8 fromNibble(int nibble)
+{
+    return (Uint8)(nibble * 17);
+}
+
+void ParticleSystem::render(SDL_Renderer* renderer)
+{
+    if(mCount == 0)
+    {
+        return;
+    }
+
+    //Bucket every visible square by its faded color, glyphs are drawn after
+    int squares = 0;
+    mUsed.clear();
+    for(int i = 0; i < mCount; i++)
+    {
+        if(mGlyph[i] != 0)
+        {
+            continue;
+        }
+
+        //Fade out over the life
+        uint32_t c = mColor[i];
+        float fade = mLife[i] * mInvLife[i];
+        fade = fade > 1 ? 1 : fade;
+        int alpha = toNibble((int)((c & 0xFF) * fade));
+        if(alpha == 0)
+        {
+            continue;
+        }
+        uint16_t key = (uint16_t)((toNibble(c >> 24) << 12) | (toNibble((c >> 16) & 0xFF) << 8) | (toNibble((c >> 8) & 0xFF) << 4) | alpha);
+
+        SDL_Rect& dst = mRects[squares];
+        dst.w = (int)(mSize[i] + 0.5f);
+        dst.h = dst.w;
+        dst.x = (int)floorf(mX[i] - dst.w * 0.5f);
+        dst.y = (int)floorf(mY[i] - dst.h * 0.5f);
+        mKeys[squares] = key;
+        squares++;
+
+        if(mBucket[key]++ == 0)
+        {
+            mUsed.push_back(key);
+        }
+    }
+
+    //Counting sort of the squares into runs, then one fill per run
+    int start = 0;
+    for(size_t u = 0; u < mUsed.size(); u++)
+    {
+        int count = mBucket[mUsed[u]];
+        mBucket[mUsed[u]] = start;
+        start += count;
+    }
+    for(int i = 0; i < squares; i++)
+    {
+        mGrouped[mBucket[mKeys[i]]++] = mRects[i];
+    }
+
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    start = 0;
+    for(size_t u = 0; u < mUsed.size(); u++)
+    {
+        int key = mUsed[u];
+        int end = mBucket[key];
+        SDL_SetRenderDrawColor(renderer, fromNibble(key >> 12), fromNibble((key >> 8) & 15), fromNibble((key >> 4) & 15), fromNibble(key & 15));
+        SDL_RenderFillRects(renderer, &mGrouped[start], end - start);
+        start = end;
+
+        //Leave the bucket empty for the next frame
+        mBucket[key] = 0;
+    }
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+    if(mGlyphCount == 0 || mTexture == NULL)
+    {
+        return;
+    }
+
+    //Pop up glyphs, no more than POPUP_GLYPH_CAPACITY of them
+    for(int i = 0; i < mCount; i++)
+    {
+        const SDL_Rect* src = mGlyph[i] != 0 ? mAtlas->glyphRect(mGlyph[i]) : NULL;
+        if(src == NULL || src->w == 0)
+        {
+            continue;
+        }
+
+        uint32_t c = mColor[i];
+        float fade = mLife[i] * mInvLife[i];
+        fade = fade > 1 ? 1 : fade;
+        SDL_Rect dst = { (int)floorf(mX[i]), (int)floorf(mY[i]), src->w, src->h };
+        SDL_SetTextureColorMod(mTexture, (Uint8)(c >> 24), (Uint8)(c >> 16), (Uint8)(c >> 8));
+        SDL_SetTextureAlphaMod(mTexture, (Uint8)((c & 0xFF) * fade));
+        SDL_RenderCopy(renderer, mTexture, src, &dst);
+    }
+
+    //Leave the atlas untinted for the labels
+    SDL_SetTextureColorMod(mTexture, 0xFF, 0xFF, 0xFF);
+    SDL_SetTextureAlphaMod(mTexture, 0xFF);
+}
+
+void ParticleSystem::clear()
+{
+    mCount = 0;
+    mGlyphCount = 0;
+}
+
+int ParticleSystem::size() const
+{
+    return mCount;
+}
+
+void ParticleSystem::move(int from, int to)
+{
+    mX[to] = mX[from];
+    mY[to] = mY[from];
+    mVelX[to] = mVelX[from];
+    mVelY[to] = mVelY[from];
+    mGravity[to] = mGravity[from];
+    mLife[to] = mLife[from];
+    mInvLife[to] = mInvLife[from];
+    mSize[to] = mSize[from];
+    mColor[to] = mColor[from];
+    mGlyph[to] = mGlyph[from];
+}
+
+float ParticleSystem::random(float low, float high)
+{
+    //Xorshift, the top 24 bits make the fraction
+    mRandom ^= mRandom << 13;
+    mRandom ^= mRandom >> 17;
+    mRandom ^= mRandom << 5;
+    return low + (high - low) * (mRandom >> 8) * (1.0f / 16777216);
+}
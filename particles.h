@@ -0,0 +1,86 @@
+//Brick break effects: debris, sparks and score pop ups kept in a fixed pool and drawn as a few batched fills
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <SDL.h>
+#include <stdint.h>
+#include <vector>
+#include "game.h"
+#include "glyphatlas.h"
+
+//Live particles at most; the pool is allocated once and bursts beyond it are cut short
+const int PARTICLE_CAPACITY = 100000;
+
+//Particles of one brick break
+const int BREAK_DEBRIS = 16;
+const int BREAK_SPARKS = 10;
+
+//Live score pop up glyphs at most, as each is its own copy from the atlas; pop ups past it are not made
+const int POPUP_GLYPH_CAPACITY = 256;
+
+//Fill colors particles are grouped into, 4 bits for each of red, green, blue and alpha
+const int PARTICLE_BUCKETS = 1 << 16;
+
+//Particles kept as structure of arrays, removed by moving the last one into their place
+class ParticleSystem
+{
+    public:
+        //Allocates the pool and the draw buffers, nothing is allocated afterwards
+        ParticleSystem();
+
+        //Draws score pop ups from the glyphs of an atlas; without one no pop ups are made
+        void setAtlas(const GlyphAtlas* atlas);
+
+        //Bursts from a broken brick: debris in its 0xRRGGBBAA color, sparks, and its score rising out of it
+        void spawnBreak(const Rect& brick, uint32_t color, int score);
+
+        //Adds a particle, false when the pool is full. Positions are in pixels, velocities and gravity per second.
+        //Glyph 0 makes a square of the given size around the point, a character that glyph with its top left there.
+        bool spawn(float x, float y, float velX, float velY, float gravity, float life, float size, uint32_t color, char glyph);
+
+        //Moves every particle on by a number of seconds and removes those that ran out
+        void update(float seconds);
+
+        //Draws every particle, fading each out over its life. Squares are grouped by their color quantized to
+        //4 bits a channel and drawn with one fill call per group; pop up glyphs are copied from the atlas.
+        void render(SDL_Renderer* renderer);
+
+        //Removes every particle
+        void clear();
+
+        int size() const;
+
+    private:
+        //Moves a particle into another slot
+        void move(int from, int to);
+
+        //Uniform random number in [low, high)
+        float random(float low, float high);
+
+        //Columns, padded to whole SIMD blocks
+        std::vector<float> mX, mY, mVelX, mVelY, mGravity;
+        std::vector<float> mLife, mInvLife, mSize;
+        std::vector<uint32_t> mColor;
+        std::vector<char> mGlyph;
+        int mCount;
+
+        //Live particles that are pop up glyphs
+        int mGlyphCount;
+
+        //Atlas the pop ups are drawn from
+        const GlyphAtlas* mAtlas;
+        SDL_Texture* mTexture;
+
+        //Squares of a frame with their color bucket, then grouped by bucket for the fills
+        std::vector<SDL_Rect> mRects;
+        std::vector<uint16_t> mKeys;
+        std::vector<SDL_Rect> mGrouped;
+
+        //Squares per bucket, then where each bucket's run starts; buckets used this frame in first use order
+        std::vector<int> mBucket;
+        std::vector<uint16_t> mUsed;
+
+        uint32_t mRandom;
+};
+
+#endif
@@ -0,0 +1,242 @@
+//Replay recording, file format and runner
+#include "replay.h"
+#include <stdio.h>
+#include <string.h>
+
+//Size of the fixed header on disk
+const int REPLAY_HEADER_SIZE = 32;
+
+ReplayRecorder::ReplayRecorder()
+{
+    begin(0);
+}
+
+void ReplayRecorder::begin(uint32_t seed, const Level* level)
+{
+    mReplay.version = REPLAY_VERSION;
+    mReplay.hashInterval = REPLAY_HASH_INTERVAL;
+    mReplay.seed = seed;
+    mReplay.level = 0;
+    mReplay.inputs.clear();
+    mReplay.checkpoints.clear();
+
+    GameState fresh;
+    if(level != NULL)
+    {
+        LevelState freshLevel;
+        initGame(fresh, freshLevel, *level, seed);
+        mReplay.level = level->checksum();
+        mReplay.finalHash = hashState(fresh, freshLevel);
+    }
+    else
+    {
+        initGame(fresh, seed);
+        mReplay.finalHash = hashState(fresh);
+    }
+}
+
+void ReplayRecorder::record(const GameInput& input, const GameState& after, const LevelState* level)
+{
+    //A tick never moves the paddle more than a byte can hold
+    int move = input.paddleMove;
+    if(move > 127) move = 127;
+    if(move < -128) move = -128;
+    mReplay.inputs.push_back((int8_t)move);
+
+    uint64_t hash = level != NULL ? hashState(after, *level) : hashState(after);
+    if(mReplay.inputs.size() % mReplay.hashInterval == 0)
+    {
+        mReplay.checkpoints.push_back(hash);
+    }
+    mReplay.finalHash = hash;
+}
+
+const Replay& ReplayRecorder::getReplay() const
+{
+    return mReplay;
+}
+
+//Little endian field writers and readers
+static void putU16(unsigned char* p, uint16_t v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static void putU32(unsigned char* p, uint32_t v)
+{
+    putU16(p, (uint16_t)v);
+    putU16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void putU64(unsigned char* p, uint64_t v)
+{
+    putU32(p, (uint32_t)v);
+    putU32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint16_t getU16(const unsigned char* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t getU32(const unsigned char* p)
+{
+    return getU16(p) | ((uint32_t)getU16(p + 2) << 16);
+}
+
+static uint64_t getU64(const unsigned char* p)
+{
+    return getU32(p) | ((uint64_t)getU32(p + 4) << 32);
+}
+
+bool saveReplay(const char* path, const Replay& replay)
+{
+    FILE* file = fopen(path, "wb");
+    if(file == NULL)
+    {
+        printf("Unable to create replay %s!\n", path);
+        return false;
+    }
+
+    unsigned char header[REPLAY_HEADER_SIZE];
+    memcpy(header, "BRKR", 4);
+    putU16(header + 4, replay.version);
+    putU16(header + 6, replay.hashInterval);
+    putU32(header + 8, replay.seed);
+    putU32(header + 12, (uint32_t)replay.inputs.size());
+    putU32(header + 16, (uint32_t)replay.checkpoints.size());
+    putU64(header + 20, replay.finalHash);
+    putU32(header + 28, replay.level);
+
+    bool success = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    if(success && !replay.inputs.empty())
+    {
+        success = fwrite(&replay.inputs[0], 1, replay.inputs.size(), file) == replay.inputs.size();
+    }
+    for(size_t i = 0; success && i < replay.checkpoints.size(); i++)
+    {
+        unsigned char hash[8];
+        putU64(hash, replay.checkpoints[i]);
+        success = fwrite(hash, 1, sizeof(hash), file) == sizeof(hash);
+    }
+
+    if(fclose(file) != 0 || !success)
+    {
+        printf("Unable to write replay %s!\n", path);
+        return false;
+    }
+    return true;
+}
+
+bool loadReplay(const char* path, Replay& replay)
+{
+    FILE* file = fopen(path, "rb");
+    if(file == NULL)
+    {
+        printf("Unable to open replay %s!\n", path);
+        return false;
+    }
+
+    //The counts in the header size the reads, so they are checked against what the file holds
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    bool success = false;
+    unsigned char header[REPLAY_HEADER_SIZE];
+    if(size < REPLAY_HEADER_SIZE || fread(header, 1, sizeof(header), file) != sizeof(header) || memcmp(header, "BRKR", 4) != 0)
+    {
+        printf("%s is not a replay!\n", path);
+    }
+    else if(getU16(header + 4) != REPLAY_VERSION)
+    {
+        printf("Replay %s is version %d, this build plays version %d!\n", path, getU16(header + 4), REPLAY_VERSION);
+    }
+    else if(getU16(header + 6) == 0 || (uint64_t)getU32(header + 12) + (uint64_t)getU32(header + 16) * 8 != (uint64_t)(size - REPLAY_HEADER_SIZE))
+    {
+        printf("Replay %s is truncated or corrupt!\n", path);
+    }
+    else
+    {
+        replay.version = getU16(header + 4);
+        replay.hashInterval = getU16(header + 6);
+        replay.seed = getU32(header + 8);
+        replay.inputs.resize(getU32(header + 12));
+        replay.checkpoints.resize(getU32(header + 16));
+        replay.finalHash = getU64(header + 20);
+        replay.level = getU32(header + 28);
+
+        success = true;
+        if(!replay.inputs.empty())
+        {
+            success = fread(&replay.inputs[0], 1, replay.inputs.size(), file) == replay.inputs.size();
+        }
+        for(size_t i = 0; success && i < replay.checkpoints.size(); i++)
+        {
+            unsigned char hash[8];
+            success = fread(hash, 1, sizeof(hash), file) == sizeof(hash);
+            replay.checkpoints[i] = getU64(hash);
+        }
+
+        if(!success)
+        {
+            printf("Replay %s is truncated!\n", path);
+        }
+    }
+
+    fclose(file);
+    return success;
+}
+
+ReplayResult runReplay(const Replay& replay, const Level* level, ReplayTickFunction onTick, void* context)
+{
+    ReplayResult result;
+    result.ticks = 0;
+    result.divergedAt = -1;
+
+    LevelState levelState;
+    if(level != NULL)
+    {
+        initGame(result.state, levelState, *level, replay.seed);
+    }
+    else
+    {
+        initGame(result.state, replay.seed);
+    }
+
+    GameInput input = { 0 };
+    size_t checkpoint = 0;
+    uint32_t count = (uint32_t)replay.inputs.size();
+    for(uint32_t tick = 0; tick < count; tick++)
+    {
+        input.paddleMove = replay.inputs[tick];
+        if(level != NULL)
+        {
+            step(result.state, levelState, input);
+        }
+        else
+        {
+            step(result.state, input);
+        }
+        if(onTick != NULL)
+        {
+            onTick(context, result.state, level != NULL ? &levelState : NULL);
+        }
+
+        //Compare against the recorded checkpoint, remembering the first mismatch
+        if((tick + 1) % replay.hashInterval == 0 && checkpoint < replay.checkpoints.size())
+        {
+            uint64_t hash = level != NULL ? hashState(result.state, levelState) : hashState(result.state);
+            if(result.divergedAt < 0 && hash != replay.checkpoints[checkpoint])
+            {
+                result.divergedAt = tick + 1;
+            }
+            checkpoint++;
+        }
+    }
+
+    result.ticks = count;
+    result.finalMatch = (level != NULL ? hashState(result.state, levelState) : hashState(result.state)) == replay.finalHash;
+    return result;
+}
@@ -0,0 +1,87 @@
+//Recorded sessions: per-tick input plus state hashes, replayed headless
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+#include <vector>
+#include "game.h"
+#include "level.h"
+
+//Bump whenever the rules change, older recordings won't replay the same
+const uint16_t REPLAY_VERSION = 1;
+
+//Ticks between checkpoint hashes
+const uint16_t REPLAY_HASH_INTERVAL = 60;
+
+//A recorded session.
+//On disk, little endian: "BRKR", version (u16), hash interval (u16), seed (u32), tick count (u32),
+//checkpoint count (u32), final hash (u64), level checksum (u32), then one signed byte of paddle movement
+//per tick, then the checkpoint hashes (u64), taken after every hash interval ticks.
+struct Replay
+{
+    uint16_t version;
+    uint16_t hashInterval;
+    uint32_t seed;
+
+    //Checksum of the level played, 0 for the classic wall
+    uint32_t level;
+
+    //Paddle movement of each tick
+    std::vector<int8_t> inputs;
+
+    //State hashes after ticks hashInterval, 2 * hashInterval, ...
+    std::vector<uint64_t> checkpoints;
+
+    //State hash after the last tick
+    uint64_t finalHash;
+};
+
+//Outcome of replaying a recording
+struct ReplayResult
+{
+    //Ticks simulated
+    uint32_t ticks;
+
+    //First tick whose checkpoint didn't match, or -1
+    int64_t divergedAt;
+
+    //Whether the final hash matched
+    bool finalMatch;
+
+    //State after the last tick
+    GameState state;
+};
+
+//Records a session as it is played
+class ReplayRecorder
+{
+    public:
+        //Initializes an empty recording
+        ReplayRecorder();
+
+        //Starts recording a game set up with the given seed, on a level or the classic wall when NULL
+        void begin(uint32_t seed, const Level* level = NULL);
+
+        //Records the input of a tick and the state it produced, with the level's bricks on a level
+        void record(const GameInput& input, const GameState& after, const LevelState* level = NULL);
+
+        //Gets the recording made so far
+        const Replay& getReplay() const;
+
+    private:
+        Replay mReplay;
+};
+
+//Writes and reads recordings, printing the reason on failure
+bool saveReplay(const char* path, const Replay& replay);
+bool loadReplay(const char* path, Replay& replay);
+
+//Called after each replayed tick with the state it produced, and the level's bricks on a level
+typedef void (*ReplayTickFunction)(void* context, const GameState& state, const LevelState* level);
+
+//Re-runs a recording from a fresh game as fast as possible, checking every hash on the way.
+//Recordings made on a level need that level, check its checksum against Replay::level first.
+//onTick, when given, sees every tick, e.g. to render it.
+ReplayResult runReplay(const Replay& replay, const Level* level = NULL, ReplayTickFunction onTick = NULL, void* context = NULL);
+
+#endif
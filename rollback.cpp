@@ -0,0 +1,332 @@
+//Versus match and rollback session
+#include "rollback.h"
+#include <string.h>
+
+void initVersus(VersusState& state, uint32_t seed)
+{
+    initGame(state.players[0], seed);
+
+    //Same wall and paddle, the dot launched the other way
+    state.players[1] = state.players[0];
+    state.players[1].ball.velX = -state.players[0].ball.velX;
+
+    state.tick = 0;
+}
+
+unsigned stepVersus(VersusState& state, const int8_t* inputs)
+{
+    unsigned events = 0;
+    for(int p = 0; p < VERSUS_PLAYERS; p++)
+    {
+        GameState& player = state.players[p];
+        if(gameOver(player))
+        {
+            continue;
+        }
+
+        GameInput input = { inputs[p] };
+        events |= step(player, input);
+
+        //The others play on the wall this player left
+        for(int other = 0; other < VERSUS_PLAYERS; other++)
+        {
+            state.players[other].bricks = player.bricks;
+            state.players[other].bricksLeft = player.bricksLeft;
+        }
+    }
+    state.tick++;
+    return events;
+}
+
+uint64_t hashVersus(const VersusState& state)
+{
+    uint64_t hash = state.tick;
+    for(int p = 0; p < VERSUS_PLAYERS; p++)
+    {
+        hash = (hash ^ hashState(state.players[p])) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+bool versusOver(const VersusState& state)
+{
+    if(state.players[0].bricksLeft == 0)
+    {
+        return true;
+    }
+    for(int p = 0; p < VERSUS_PLAYERS; p++)
+    {
+        if(!gameOver(state.players[p]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int versusWinner(const VersusState& state)
+{
+    int winner = -1, best = -1;
+    for(int p = 0; p < VERSUS_PLAYERS; p++)
+    {
+        if(state.players[p].score > best)
+        {
+            winner = p;
+            best = state.players[p].score;
+        }
+        else if(state.players[p].score == best)
+        {
+            winner = -1;
+        }
+    }
+    return winner;
+}
+
+//Little endian fields, as in replay files
+static void putU16(uint8_t* p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void putU32(uint8_t* p, uint32_t v)
+{
+    putU16(p, (uint16_t)v);
+    putU16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void putU64(uint8_t* p, uint64_t v)
+{
+    putU32(p, (uint32_t)v);
+    putU32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint16_t getU16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t getU32(const uint8_t* p)
+{
+    return getU16(p) | ((uint32_t)getU16(p + 2) << 16);
+}
+
+static uint64_t getU64(const uint8_t* p)
+{
+    return getU32(p) | ((uint64_t)getU32(p + 4) << 32);
+}
+
+int encodePacket(const RollbackPacket& packet, uint8_t* data)
+{
+    memcpy(data, "BRKN", 4);
+    putU32(data + 4, packet.firstTick);
+    putU16(data + 8, (uint16_t)packet.count);
+    putU32(data + 10, packet.ack);
+    putU32(data + 14, packet.hashTick);
+    putU64(data + 18, packet.hash);
+    memcpy(data + ROLLBACK_PACKET_HEADER, packet.inputs, packet.count);
+    return ROLLBACK_PACKET_HEADER + packet.count;
+}
+
+bool decodePacket(const uint8_t* data, int size, RollbackPacket& packet)
+{
+    if(size < ROLLBACK_PACKET_HEADER || memcmp(data, "BRKN", 4) != 0)
+    {
+        return false;
+    }
+    packet.firstTick = getU32(data + 4);
+    packet.count = getU16(data + 8);
+    packet.ack = getU32(data + 10);
+    packet.hashTick = getU32(data + 14);
+    packet.hash = getU64(data + 18);
+    if(packet.count > ROLLBACK_MAX_PACKET_INPUTS || size != ROLLBACK_PACKET_HEADER + packet.count)
+    {
+        return false;
+    }
+    memcpy(packet.inputs, data + ROLLBACK_PACKET_HEADER, packet.count);
+    return true;
+}
+
+RollbackSession::RollbackSession()
+{
+    //Initialize
+    start(0, 0);
+}
+
+void RollbackSession::start(int localPlayer, uint32_t seed)
+{
+    mLocal = localPlayer;
+    mRemote = 1 - localPlayer;
+    initVersus(mState, seed);
+    memset(mInputs, 0, sizeof(mInputs));
+    memset(mUsed, 0, sizeof(mUsed));
+    mConfirmed = 0;
+    mAcknowledged = 0;
+    mChecked = 0;
+    mRollbacks = 0;
+    mResimulated = 0;
+    mMaxDepth = 0;
+    mStalls = 0;
+    mDesyncs = 0;
+}
+
+bool RollbackSession::advance(int8_t input)
+{
+    //Wait rather than predict too far, or lose inputs the remote still needs from the history
+    //Remote inputs may already be known past the current tick
+    if(mState.tick >= mConfirmed + ROLLBACK_MAX_PREDICTION || mState.tick >= mAcknowledged + ROLLBACK_MAX_PACKET_INPUTS)
+    {
+        mStalls++;
+        return false;
+    }
+
+    mInputs[mLocal][mState.tick % ROLLBACK_HISTORY] = input;
+    simulate();
+    return true;
+}
+
+void RollbackSession::receive(const RollbackPacket& packet)
+{
+    //Packets arrive late, twice or out of order; only the inputs right after the known ones count
+    uint32_t wrong = mState.tick;
+    for(int i = 0; i < packet.count; i++)
+    {
+        uint32_t tick = packet.firstTick + i;
+        if(tick != mConfirmed)
+        {
+            continue;
+        }
+
+        //Slots back to the oldest input still needed are taken, the remote's stall limits keep it well short of them
+        if(tick < mState.tick + (ROLLBACK_HISTORY - ROLLBACK_MAX_PACKET_INPUTS))
+        {
+            mInputs[mRemote][tick % ROLLBACK_HISTORY] = packet.inputs[i];
+            if(tick < mState.tick && mUsed[tick % ROLLBACK_HISTORY] != packet.inputs[i] && tick < wrong)
+            {
+                wrong = tick;
+            }
+            mConfirmed++;
+        }
+    }
+    if(packet.ack > mAcknowledged && packet.ack <= mState.tick)
+    {
+        mAcknowledged = packet.ack;
+    }
+
+    if(wrong < mState.tick)
+    {
+        rollback(wrong);
+    }
+
+    //Once both sides know every input before a tick their states there must agree
+    uint32_t hashTick = packet.hashTick;
+    if(hashTick > mChecked && hashTick <= mConfirmed && hashTick <= mState.tick && mState.tick - hashTick < (uint32_t)ROLLBACK_HISTORY)
+    {
+        mChecked = hashTick;
+        if(hashVersus(savedState(hashTick)) != packet.hash)
+        {
+            mDesyncs++;
+        }
+    }
+}
+
+void RollbackSession::makePacket(RollbackPacket& packet) const
+{
+    packet.firstTick = mAcknowledged;
+    packet.count = (int)(mState.tick - mAcknowledged);
+    for(int i = 0; i < packet.count; i++)
+    {
+        packet.inputs[i] = mInputs[mLocal][(mAcknowledged + i) % ROLLBACK_HISTORY];
+    }
+    packet.ack = mConfirmed;
+    packet.hashTick = mConfirmed < mState.tick ? mConfirmed : mState.tick;
+    packet.hash = hashVersus(savedState(packet.hashTick));
+}
+
+const VersusState& RollbackSession::state() const
+{
+    return mState;
+}
+
+uint32_t RollbackSession::tick() const
+{
+    return mState.tick;
+}
+
+uint32_t RollbackSession::confirmedTicks() const
+{
+    return mConfirmed < mState.tick ? mConfirmed : mState.tick;
+}
+
+uint32_t RollbackSession::acknowledgedTicks() const
+{
+    return mAcknowledged;
+}
+
+uint32_t RollbackSession::rollbacks() const
+{
+    return mRollbacks;
+}
+
+uint32_t RollbackSession::resimulated() const
+{
+    return mResimulated;
+}
+
+uint32_t RollbackSession::maxDepth() const
+{
+    return mMaxDepth;
+}
+
+uint32_t RollbackSession::stalls() const
+{
+    return mStalls;
+}
+
+uint32_t RollbackSession::desyncs() const
+{
+    return mDesyncs;
+}
+
+void RollbackSession::simulate()
+{
+    uint32_t tick = mState.tick;
+    mSaved[tick % ROLLBACK_HISTORY] = mState;
+
+    //Past the known remote inputs, guess the remote keeps doing what it did last
+    int8_t inputs[VERSUS_PLAYERS];
+    inputs[mLocal] = mInputs[mLocal][tick % ROLLBACK_HISTORY];
+    if(tick < mConfirmed)
+    {
+        inputs[mRemote] = mInputs[mRemote][tick % ROLLBACK_HISTORY];
+    }
+    else
+    {
+        inputs[mRemote] = mConfirmed > 0 ? mInputs[mRemote][(mConfirmed - 1) % ROLLBACK_HISTORY] : 0;
+    }
+    mUsed[tick % ROLLBACK_HISTORY] = inputs[mRemote];
+
+    stepVersus(mState, inputs);
+}
+
+void RollbackSession::rollback(uint32_t from)
+{
+    uint32_t to = mState.tick;
+    mState = mSaved[from % ROLLBACK_HISTORY];
+    while(mState.tick < to)
+    {
+        simulate();
+    }
+
+    mRollbacks++;
+    mResimulated += to - from;
+    if(to - from > mMaxDepth)
+    {
+        mMaxDepth = to - from;
+    }
+}
+
+const VersusState& RollbackSession::savedState(uint32_t tick) const
+{
+    return tick == mState.tick ? mState : mSaved[tick % ROLLBACK_HISTORY];
+}
@@ -0,0 +1,154 @@
+//Two player versus on a shared wall, and rollback netcode that keeps two copies of it in step over a lossy link
+#ifndef ROLLBACK_H
+#define ROLLBACK_H
+
+#include <stdint.h>
+#include <type_traits>
+#include "game.h"
+
+//Players of a versus game
+const int VERSUS_PLAYERS = 2;
+
+//Ticks of saved states and inputs a session keeps, a power of two
+const int ROLLBACK_HISTORY = 128;
+
+//Ticks a peer may run past the last remote input it has before it waits
+const int ROLLBACK_MAX_PREDICTION = 16;
+
+//Local inputs a packet carries at most; a peer also waits when the remote has acknowledged fewer than this
+const int ROLLBACK_MAX_PACKET_INPUTS = 64;
+
+//Encoded size of the packet fields before the inputs, and of the largest packet
+const int ROLLBACK_PACKET_HEADER = 26;
+const int ROLLBACK_PACKET_SIZE = ROLLBACK_PACKET_HEADER + ROLLBACK_MAX_PACKET_INPUTS;
+
+//Versus on a shared wall: each player has an own dot, paddle, lives and score,
+//and a brick broken by either is gone for both
+struct VersusState
+{
+    GameState players[VERSUS_PLAYERS];
+
+    //Number of steps simulated so far
+    uint32_t tick;
+};
+
+//Saved and restored by copy on every rollback
+static_assert(std::is_trivially_copyable<VersusState>::value, "VersusState must stay trivially copyable");
+
+//Sets up a fresh match; the seed picks the launch of the first player, the second one's is mirrored
+void initVersus(VersusState& state, uint32_t seed);
+
+//Advances the match by one tick, the first player first, with one paddle move per player.
+//Players out of lives stand still. Returns the GameEvent flags raised for either player.
+unsigned stepVersus(VersusState& state, const int8_t* inputs);
+
+//Hash of everything in the match
+uint64_t hashVersus(const VersusState& state);
+
+//The wall is cleared or nobody has lives left
+bool versusOver(const VersusState& state);
+
+//Player with the higher score, -1 for a draw
+int versusWinner(const VersusState& state);
+
+//What a peer sends every tick
+struct RollbackPacket
+{
+    //Sender's inputs from firstTick on, all it has that the receiver hasn't acknowledged
+    uint32_t firstTick;
+    int count;
+    int8_t inputs[ROLLBACK_MAX_PACKET_INPUTS];
+
+    //Receiver's inputs the sender has, every tick before this
+    uint32_t ack;
+
+    //Sender's state hash at the start of hashTick, once every input before it is known
+    uint32_t hashTick;
+    uint64_t hash;
+};
+
+//Writes a packet into at least ROLLBACK_PACKET_SIZE bytes and returns the bytes used
+int encodePacket(const RollbackPacket& packet, uint8_t* data);
+
+//Reads a packet, false if the bytes aren't one
+bool decodePacket(const uint8_t* data, int size, RollbackPacket& packet);
+
+class RollbackSession
+{
+    public:
+        //Initializes a session for the first player
+        RollbackSession();
+
+        //Starts a match as one of the players
+        void start(int localPlayer, uint32_t seed);
+
+        //Simulates the next tick with the local input, predicting the remote one as its last known input.
+        //Returns false without simulating while too far ahead of the remote, try again next frame.
+        bool advance(int8_t input);
+
+        //Takes a packet from the remote. Inputs that prove a prediction wrong roll the match back
+        //to the first wrong tick and simulate it forward again up to the current one.
+        void receive(const RollbackPacket& packet);
+
+        //Fills the next packet to send
+        void makePacket(RollbackPacket& packet) const;
+
+        //Current match, the remote paddle predicted past the confirmed ticks
+        const VersusState& state() const;
+
+        //Ticks simulated, and ticks whose inputs are all known and can't change any more
+        uint32_t tick() const;
+        uint32_t confirmedTicks() const;
+
+        //Local ticks the remote has
+        uint32_t acknowledgedTicks() const;
+
+        //Statistics: rollbacks, ticks simulated again, the deepest rollback,
+        //advances refused while waiting for the remote and confirmed ticks whose hashes disagreed
+        uint32_t rollbacks() const;
+        uint32_t resimulated() const;
+        uint32_t maxDepth() const;
+        uint32_t stalls() const;
+        uint32_t desyncs() const;
+
+    private:
+        //Saves the state and simulates the current tick with the best inputs known
+        void simulate();
+
+        //Loads the state before a tick and simulates forward again
+        void rollback(uint32_t from);
+
+        //State at the start of a tick still in the history
+        const VersusState& savedState(uint32_t tick) const;
+
+        int mLocal;
+        int mRemote;
+
+        //Current match
+        VersusState mState;
+
+        //State at the start of each recent tick
+        VersusState mSaved[ROLLBACK_HISTORY];
+
+        //Inputs by player and tick; remote ones are valid before mConfirmed, and may arrive ahead of mTick
+        int8_t mInputs[VERSUS_PLAYERS][ROLLBACK_HISTORY];
+
+        //Remote input each tick was simulated with, to spot wrong predictions
+        int8_t mUsed[ROLLBACK_HISTORY];
+
+        //Remote inputs are known before mConfirmed, the remote has local ones before mAcknowledged
+        uint32_t mConfirmed;
+        uint32_t mAcknowledged;
+
+        //Latest tick whose remote hash was compared
+        uint32_t mChecked;
+
+        //Statistics
+        uint32_t mRollbacks;
+        uint32_t mResimulated;
+        uint32_t mMaxDepth;
+        uint32_t mStalls;
+        uint32_t mDesyncs;
+};
+
+#endif
@@ -0,0 +1,228 @@
+//Simulation thread
+#include "simthread.h"
+#include <chrono>
+#include "trace.h"
+
+//Length of a tick on the simulation clock
+static const uint64_t TICK_LENGTH = 1000000000ull / TICKS_PER_SECOND;
+
+SimThread::SimThread()
+{
+    //Initialize
+    mCommandPending = false;
+    mHasLevel = false;
+    mInitialLevel.level = NULL;
+    mRecorder = NULL;
+}
+
+SimThread::~SimThread()
+{
+    stop();
+}
+
+uint64_t SimThread::now()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void SimThread::start(const GameState& initial, ReplayRecorder* recorder, const LevelState* level)
+{
+    stop();
+
+    mInitial = initial;
+    mHasLevel = level != NULL;
+    if(mHasLevel)
+    {
+        mInitialLevel = *level;
+    }
+    mRecorder = recorder;
+    mCommandPending = false;
+
+    Snapshot first;
+    first.state = initial;
+    first.prev = initial;
+    first.tickTime = now();
+    first.bounces = 0;
+    first.breaks = 0;
+    first.livesLost = 0;
+    first.inputs = 0;
+    first.inputTime = 0;
+    first.inputTickTime = 0;
+    if(mHasLevel)
+    {
+        first.levelAlive = level->alive;
+    }
+    mSnapshots.reset(first);
+
+    mThread = std::thread(&SimThread::run, this);
+}
+
+void SimThread::stop()
+{
+    if(mThread.joinable())
+    {
+        //Retry until the thread makes room
+        while(!send(SIM_QUIT))
+        {
+            std::this_thread::yield();
+        }
+        mThread.join();
+    }
+}
+
+bool SimThread::send(SimCommand command, int value, uint64_t time)
+{
+    SimInput input = { command, value, time != 0 ? time : now() };
+    if(!mInput.push(input))
+    {
+        return false;
+    }
+
+    //Paddle input waits for the next tick, commands wake the thread if it is idle
+    if(command != SIM_PADDLE_HOLD)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mCommandPending = true;
+        }
+        mWake.notify_one();
+    }
+    return true;
+}
+
+const Snapshot& SimThread::latest()
+{
+    mSnapshots.update();
+    return mSnapshots.front();
+}
+
+bool SimThread::drainInput(HeldInput& paddle, bool& paused, uint64_t& nextTick)
+{
+    SimInput e;
+    while(mInput.pop(e))
+    {
+        switch(e.command)
+        {
+            case SIM_PADDLE_HOLD:
+                paddle.held = e.value;
+                if(paddle.tapped == 0)
+                {
+                    paddle.tapped = e.value;
+                }
+                if(paddle.changed == 0)
+                {
+                    paddle.changed = e.time;
+                }
+                traceRecord("inputWait", e.time, now());
+                break;
+            case SIM_PAUSE:
+                paused = true;
+                break;
+            case SIM_RESUME:
+                //Time spent paused does not count towards the simulation
+                paused = false;
+                nextTick = now() + TICK_LENGTH;
+                break;
+            case SIM_QUIT:
+                return false;
+        }
+    }
+    return true;
+}
+
+void SimThread::run()
+{
+    traceThreadName("simulation");
+
+    GameState game = mInitial;
+    LevelState level = mInitialLevel;
+    HeldInput paddle = { 0, 0, 0 };
+    GameInput input = { 0 };
+    bool paused = true;
+    uint64_t nextTick = now();
+    Snapshot last = mSnapshots.front();
+
+    for(;;)
+    {
+        if(!drainInput(paddle, paused, nextTick))
+        {
+            return;
+        }
+
+        //Sleep until a command arrives while paused or once the game is decided
+        if(paused || gameOver(game) || gameWon(game))
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWake.wait(lock, [this]{ return mCommandPending; });
+            mCommandPending = false;
+            continue;
+        }
+
+        //Wait for the next tick to come due
+        uint64_t time = now();
+        if(time < nextTick)
+        {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(nextTick - time));
+            continue;
+        }
+
+        //Drop what is beyond the catch up limit
+        if(time - nextTick > TICK_LENGTH * SIM_MAX_CATCH_UP)
+        {
+            nextTick = time - TICK_LENGTH * SIM_MAX_CATCH_UP;
+        }
+
+        //Run as many fixed steps as have come due
+        while(nextTick <= time && !gameOver(game) && !gameWon(game))
+        {
+            TRACE_SCOPE("step");
+
+            //Sample the paddle keys; a key let go before the tick came still moves the paddle once
+            input.paddleMove = paddle.held != 0 ? paddle.held : paddle.tapped;
+            paddle.tapped = 0;
+            if(paddle.changed != 0)
+            {
+                last.inputs++;
+                last.inputTime = paddle.changed;
+                last.inputTickTime = now();
+                paddle.changed = 0;
+            }
+
+            //Move the paddle and the dot and check collision
+            Snapshot& snapshot = mSnapshots.back();
+            snapshot.prev = game;
+            unsigned events = mHasLevel ? step(game, level, input) : step(game, input);
+            if(mRecorder != NULL)
+            {
+                mRecorder->record(input, game, mHasLevel ? &level : NULL);
+            }
+
+            //Don't blend the dot across a reset to the centre
+            if(events & EVENT_LIFE_LOST)
+            {
+                snapshot.prev.ball = game.ball;
+            }
+
+            //Count the events for the renderer and hand over the tick
+            last.bounces += (events & EVENT_BOUNCE) ? 1 : 0;
+            last.breaks += (events & EVENT_BREAK) ? 1 : 0;
+            last.livesLost += (events & EVENT_LIFE_LOST) ? 1 : 0;
+            snapshot.state = game;
+            snapshot.tickTime = nextTick;
+            snapshot.bounces = last.bounces;
+            snapshot.breaks = last.breaks;
+            snapshot.livesLost = last.livesLost;
+            snapshot.inputs = last.inputs;
+            snapshot.inputTime = last.inputTime;
+            snapshot.inputTickTime = last.inputTickTime;
+            if(mHasLevel)
+            {
+                //Copies into the slot's own storage, which keeps its capacity from the previous use
+                snapshot.levelAlive = level.alive;
+            }
+            mSnapshots.publish();
+
+            nextTick += TICK_LENGTH;
+        }
+    }
+}
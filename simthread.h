@@ -0,0 +1,130 @@
+//Simulation running on its own thread, fed timestamped input through a queue and publishing state snapshots
+#ifndef SIMTHREAD_H
+#define SIMTHREAD_H
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "game.h"
+#include "level.h"
+#include "replay.h"
+#include "spscqueue.h"
+#include "triplebuffer.h"
+
+//Input slots between the event thread and the simulation
+const int SIM_QUEUE_SIZE = 256;
+
+//Ticks run at most to catch up after a stall, older time is dropped
+const int SIM_MAX_CATCH_UP = 8;
+
+//What the event thread can send
+enum SimCommand
+{
+    //Paddle direction held from now on, -1 left, 0 none, 1 right; applied on every tick until the next change
+    SIM_PADDLE_HOLD,
+
+    //Stop and restart the clock
+    SIM_PAUSE,
+    SIM_RESUME,
+
+    //End the thread
+    SIM_QUIT
+};
+
+struct SimInput
+{
+    SimCommand command;
+    int value;
+
+    //SimThread::now() when the event happened, the simulation traces how long it waited
+    uint64_t time;
+};
+
+//Paddle keys as the simulation samples them each tick
+struct HeldInput
+{
+    //Direction held now, and the first one pressed since the last tick, so a tap between two ticks still moves
+    int held;
+    int tapped;
+
+    //Time of the oldest change no tick has applied yet, 0 when there is none
+    uint64_t changed;
+};
+
+//Everything the renderer needs from one tick
+struct Snapshot
+{
+    //State after the latest tick, and the one before it to blend from
+    GameState state;
+    GameState prev;
+
+    //Standing bricks of a level game after the latest tick, empty on the classic wall
+    std::vector<uint64_t> levelAlive;
+
+    //SimThread::now() at which the latest tick was due
+    uint64_t tickTime;
+
+    //Events raised so far, as totals so none are lost when the renderer skips snapshots
+    uint32_t bounces;
+    uint32_t breaks;
+    uint32_t livesLost;
+
+    //Paddle input changes applied so far; for the latest, when it happened and when the tick applying it ran
+    uint32_t inputs;
+    uint64_t inputTime;
+    uint64_t inputTickTime;
+};
+
+class SimThread
+{
+    public:
+        //Initializes variables
+        SimThread();
+
+        //Stops the thread
+        ~SimThread();
+
+        //Starts the simulation paused at the given state, on a level when its state is given;
+        //each tick is recorded when a recorder is given
+        void start(const GameState& initial, ReplayRecorder* recorder, const LevelState* level = NULL);
+
+        //Ends the thread and waits for it, the recorder may be used again afterwards
+        void stop();
+
+        //Event thread side: queues input that happened at a time on the simulation clock, now when 0;
+        //false when the queue is full
+        bool send(SimCommand command, int value = 0, uint64_t time = 0);
+
+        //Render thread side: the newest snapshot, unchanged until the next call
+        const Snapshot& latest();
+
+        //Nanoseconds on the simulation clock
+        static uint64_t now();
+
+    private:
+        //Thread body
+        void run();
+
+        //Applies queued input, returns false on SIM_QUIT
+        bool drainInput(HeldInput& paddle, bool& paused, uint64_t& nextTick);
+
+        std::thread mThread;
+
+        SpscQueue<SimInput, SIM_QUEUE_SIZE> mInput;
+        TripleBuffer<Snapshot> mSnapshots;
+
+        //Wakes the thread while it waits for a command
+        std::mutex mMutex;
+        std::condition_variable mWake;
+        bool mCommandPending;
+
+        GameState mInitial;
+        LevelState mInitialLevel;
+        bool mHasLevel;
+        ReplayRecorder* mRecorder;
+};
+
+#endif
@@ -0,0 +1,565 @@
+//CPU framebuffer renderer: rows are filled and blended sixteen bytes at a time, whatever the pixel format
+#include "softraster.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "board.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+//Colors of the front end, as 0xRRGGBBAA
+const uint32_t CLEAR_COLOR = 0xFFFFFFFF;
+const uint32_t PADDLE_COLOR = 0x000000FF;
+const uint32_t TEXT_COLOR = 0x000000FF;
+
+//Blend weight of a fully covering pixel
+const int FULL_WEIGHT = 128;
+
+//Overlap of two boxes, empty when they don't meet
+static Rect intersect(const Rect& a, const Rect& b)
+{
+    int left = a.x > b.x ? a.x : b.x;
+    int top = a.y > b.y ? a.y : b.y;
+    int right = a.x + a.w < b.x + b.w ? a.x + a.w : b.x + b.w;
+    int bottom = a.y + a.h < b.y + b.h ? a.y + a.h : b.y + b.h;
+    Rect r = { left, top, right > left ? right - left : 0, bottom > top ? bottom - top : 0 };
+    return r;
+}
+
+//Repeats a pixel over sixteen bytes; rows start on a pixel, so every sixteen byte store stays in phase
+static void makePattern(const uint8_t* pixel, int bytesPerPixel, uint8_t* pattern)
+{
+    for(int i = 0; i < 16; i++)
+    {
+        pattern[i] = pixel[i % bytesPerPixel];
+    }
+}
+
+//Writes a pattern over a row
+static void fillRow(uint8_t* dst, int bytes, const uint8_t* pattern)
+{
+    int i = 0;
+#if defined(__SSE2__)
+    __m128i p = _mm_loadu_si128((const __m128i*)pattern);
+    for(; i + 16 <= bytes; i += 16)
+    {
+        _mm_storeu_si128((__m128i*)(dst + i), p);
+    }
+#endif
+    for(; i < bytes; i++)
+    {
+        dst[i] = pattern[i & 15];
+    }
+}
+
+//Moves each byte of a row towards src by its weight out of FULL_WEIGHT
+static void blendRow(uint8_t* dst, const uint8_t* src, const uint8_t* weight, int bytes)
+{
+    int i = 0;
+#if defined(__SSE2__)
+    //Differences times weights stay within 16 bits, as weights are at most 128
+    const __m128i zero = _mm_setzero_si128();
+    for(; i + 16 <= bytes; i += 16)
+    {
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i w = _mm_loadu_si128((const __m128i*)(weight + i));
+
+        __m128i dLo = _mm_unpacklo_epi8(d, zero);
+        __m128i dHi = _mm_unpackhi_epi8(d, zero);
+        __m128i lo = _mm_mullo_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(s, zero), dLo), _mm_unpacklo_epi8(w, zero));
+        __m128i hi = _mm_mullo_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(s, zero), dHi), _mm_unpackhi_epi8(w, zero));
+        lo = _mm_add_epi16(dLo, _mm_srai_epi16(lo, 7));
+        hi = _mm_add_epi16(dHi, _mm_srai_epi16(hi, 7));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for(; i < bytes; i++)
+    {
+        dst[i] = (uint8_t)(dst[i] + (((src[i] - dst[i]) * weight[i]) >> 7));
+    }
+}
+
+//Fills a box already clipped to the frame
+static void fillRect(uint8_t* pixels, int pitch, int bytesPerPixel, const Rect& r, const uint8_t* pixel)
+{
+    uint8_t pattern[16];
+    makePattern(pixel, bytesPerPixel, pattern);
+    for(int y = r.y; y < r.y + r.h; y++)
+    {
+        fillRow(pixels + y * pitch + r.x * bytesPerPixel, r.w * bytesPerPixel, pattern);
+    }
+}
+
+//Weight of a coverage or alpha value
+static uint8_t toWeight(int value)
+{
+    return (uint8_t)((value * FULL_WEIGHT + 127) / 255);
+}
+
+//Little endian fields of a file
+static uint32_t readLE(const uint8_t* p, int bytes)
+{
+    uint32_t value = 0;
+    for(int i = bytes - 1; i >= 0; i--)
+    {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+SoftRaster::SoftRaster()
+{
+    //Initialize
+    mSpriteSourceW = 0;
+    mSpriteSourceH = 0;
+    mSpriteW = 0;
+    mSpriteH = 0;
+    mHasFont = false;
+    mFont.width = 0;
+    mFont.height = 0;
+    for(int i = 0; i < SOFT_GLYPHS; i++)
+    {
+        Rect empty = { 0, 0, 0, 0 };
+        mFont.glyphs[i] = empty;
+        mFont.advance[i] = 0;
+        mGlyphOffset[i] = 0;
+        mGlyphW[i] = 0;
+        mGlyphH[i] = 0;
+    }
+
+    init(1, SOFT_RGBA);
+}
+
+bool SoftRaster::init(int scale, SoftFormat format)
+{
+    if(scale < 1)
+    {
+        printf("Software raster scale must be at least 1!\n");
+        return false;
+    }
+
+    mScale = scale;
+    mFormat = format;
+    mBytesPerPixel = format == SOFT_GRAY ? 1 : 4;
+    mWidth = toFrame(SCREEN_WIDTH);
+    mHeight = toFrame(SCREEN_HEIGHT);
+    mPitch = mWidth * mBytesPerPixel;
+    toPixel(CLEAR_COLOR, mClearPixel);
+    toPixel(TEXT_COLOR, mTextPixel);
+
+    mFrame.assign(mPitch * mHeight, 0);
+    mBackground.assign(mPitch * mHeight, 0);
+    mBackgroundValid = false;
+    mBackgroundLevel = NULL;
+    for(int i = 0; i < 2; i++)
+    {
+        Rect empty = { 0, 0, 0, 0 };
+        mDrawn[i] = empty;
+    }
+
+    prepareSprite();
+    prepareFont();
+    return true;
+}
+
+void SoftRaster::setSprite(const uint8_t* rgba, int width, int height, int pitch)
+{
+    mSpriteSourceW = width;
+    mSpriteSourceH = height;
+    mSpriteSource.resize(width * height * 4);
+    for(int y = 0; y < height; y++)
+    {
+        memcpy(&mSpriteSource[y * width * 4], rgba + y * pitch, width * 4);
+    }
+    prepareSprite();
+}
+
+bool SoftRaster::loadSprite(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if(file == NULL)
+    {
+        printf("Unable to open sprite %s!\n", path);
+        return false;
+    }
+    std::vector<uint8_t> data;
+    uint8_t buffer[4096];
+    size_t got;
+    while((got = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        data.insert(data.end(), buffer, buffer + got);
+    }
+    fclose(file);
+
+    //File header, then a BITMAPINFOHEADER or a later version of it
+    if(data.size() < 54 || data[0] != 'B' || data[1] != 'M')
+    {
+        printf("Sprite %s is not a BMP!\n", path);
+        return false;
+    }
+    uint32_t offset = readLE(&data[10], 4);
+    int width = (int)readLE(&data[18], 4);
+    int height = (int)readLE(&data[22], 4);
+    int bits = (int)readLE(&data[28], 2);
+    uint32_t compression = readLE(&data[30], 4);
+
+    //Positive heights are stored bottom row first
+    bool bottomUp = height > 0;
+    height = bottomUp ? height : -height;
+    int bytesPerPixel = bits / 8;
+    int stride = (width * bytesPerPixel + 3) & ~3;
+    if(width <= 0 || height <= 0 || (bits != 24 && bits != 32) || (compression != 0 && compression != 3)
+       || offset + (uint64_t)stride * height > data.size())
+    {
+        printf("Sprite %s is not an uncompressed 24 or 32 bit BMP!\n", path);
+        return false;
+    }
+
+    std::vector<uint8_t> rgba(width * height * 4);
+    for(int y = 0; y < height; y++)
+    {
+        const uint8_t* row = &data[offset + stride * (bottomUp ? height - 1 - y : y)];
+        for(int x = 0; x < width; x++)
+        {
+            const uint8_t* p = row + x * bytesPerPixel;
+            uint8_t* out = &rgba[(y * width + x) * 4];
+            out[0] = p[2];
+            out[1] = p[1];
+            out[2] = p[0];
+
+            //Color key the sprite, cyan is transparent
+            out[3] = (p[2] == 0 && p[1] == 0xFF && p[0] == 0xFF) ? 0 : 0xFF;
+        }
+    }
+
+    setSprite(&rgba[0], width, height, width * 4);
+    return true;
+}
+
+void SoftRaster::setFont(const SoftFont& font)
+{
+    mFont = font;
+    mHasFont = true;
+    prepareFont();
+    mBackgroundValid = false;
+}
+
+void SoftRaster::setMessage(const char* text)
+{
+    std::string message = text != NULL ? text : "";
+    if(message != mMessage)
+    {
+        mMessage = message;
+        mBackgroundValid = false;
+    }
+}
+
+int SoftRaster::toFrame(int c) const
+{
+    return floorDiv(c + mScale / 2, mScale);
+}
+
+Rect SoftRaster::toFrame(const Rect& r) const
+{
+    int left = toFrame(r.x), top = toFrame(r.y);
+    Rect f = { left, top, toFrame(r.x + r.w) - left, toFrame(r.y + r.h) - top };
+    return f;
+}
+
+void SoftRaster::toPixel(uint32_t color, uint8_t* pixel) const
+{
+    int r = (color >> 24) & 0xFF, g = (color >> 16) & 0xFF, b = (color >> 8) & 0xFF;
+    if(mFormat == SOFT_GRAY)
+    {
+        //Rec. 601 luma
+        pixel[0] = (uint8_t)((77 * r + 150 * g + 29 * b + 128) >> 8);
+    }
+    else
+    {
+        pixel[0] = (uint8_t)r;
+        pixel[1] = (uint8_t)g;
+        pixel[2] = (uint8_t)b;
+        pixel[3] = 0xFF;
+    }
+}
+
+void SoftRaster::prepareSprite()
+{
+    if(mSpriteSource.empty())
+    {
+        mSpriteW = 0;
+        mSpriteH = 0;
+        return;
+    }
+
+    //Each frame pixel averages a block of sprite pixels, colors weighted by their alpha
+    mSpriteW = (mSpriteSourceW + mScale - 1) / mScale;
+    mSpriteH = (mSpriteSourceH + mScale - 1) / mScale;
+    mSprite.assign(mSpriteW * mSpriteH * mBytesPerPixel, 0);
+    mSpriteWeight.assign(mSpriteW * mSpriteH * mBytesPerPixel, 0);
+    for(int y = 0; y < mSpriteH; y++)
+    {
+        for(int x = 0; x < mSpriteW; x++)
+        {
+            int count = 0, alpha = 0, r = 0, g = 0, b = 0;
+            for(int sy = y * mScale; sy < (y + 1) * mScale && sy < mSpriteSourceH; sy++)
+            {
+                for(int sx = x * mScale; sx < (x + 1) * mScale && sx < mSpriteSourceW; sx++)
+                {
+                    const uint8_t* p = &mSpriteSource[(sy * mSpriteSourceW + sx) * 4];
+                    count++;
+                    alpha += p[3];
+                    r += p[0] * p[3];
+                    g += p[1] * p[3];
+                    b += p[2] * p[3];
+                }
+            }
+
+            int i = (y * mSpriteW + x) * mBytesPerPixel;
+            if(alpha > 0)
+            {
+                toPixel((uint32_t)(r / alpha) << 24 | (uint32_t)(g / alpha) << 16 | (uint32_t)(b / alpha) << 8 | 0xFF, &mSprite[i]);
+            }
+            memset(&mSpriteWeight[i], toWeight(alpha / count), mBytesPerPixel);
+        }
+    }
+}
+
+void SoftRaster::prepareFont()
+{
+    mGlyphWeights.clear();
+    int widest = 0;
+    for(int c = 0; c < SOFT_GLYPHS && mHasFont; c++)
+    {
+        const Rect& g = mFont.glyphs[c];
+        mGlyphOffset[c] = (int)mGlyphWeights.size();
+        mGlyphW[c] = (g.w + mScale - 1) / mScale;
+        mGlyphH[c] = (g.h + mScale - 1) / mScale;
+        widest = mGlyphW[c] > widest ? mGlyphW[c] : widest;
+
+        //Average the coverage of each block, the same weight for every byte of a pixel
+        for(int y = 0; y < mGlyphH[c]; y++)
+        {
+            for(int x = 0; x < mGlyphW[c]; x++)
+            {
+                int count = 0, coverage = 0;
+                for(int sy = y * mScale; sy < (y + 1) * mScale && sy < g.h; sy++)
+                {
+                    for(int sx = x * mScale; sx < (x + 1) * mScale && sx < g.w; sx++)
+                    {
+                        count++;
+                        coverage += mFont.coverage[(g.y + sy) * mFont.width + g.x + sx];
+                    }
+                }
+                mGlyphWeights.insert(mGlyphWeights.end(), mBytesPerPixel, toWeight(coverage / count));
+            }
+        }
+    }
+
+    mTextRow.resize(widest * mBytesPerPixel + 16);
+    for(size_t i = 0; i < mTextRow.size(); i++)
+    {
+        mTextRow[i] = mTextPixel[i % mBytesPerPixel];
+    }
+}
+
+Rect SoftRaster::paddleBox(const GameState& state) const
+{
+    Rect paddle = { state.paddle.x, state.paddle.y, PADDLE_WIDTH, PADDLE_HEIGHT };
+    return toFrame(paddle);
+}
+
+Rect SoftRaster::dotBox(const GameState& state) const
+{
+    //Rounded to the nearest pixel like the front end
+    Rect dot = { (int)floor(state.ball.x + 0.5), (int)floor(state.ball.y + 0.5), DOT_WIDTH, DOT_HEIGHT };
+    Rect box = toFrame(dot);
+    if(mSpriteW > 0)
+    {
+        box.w = mSpriteW;
+        box.h = mSpriteH;
+    }
+    return box;
+}
+
+void SoftRaster::drawWall(uint8_t* pixels, int pitch, const GameState& state, const LevelState* level) const
+{
+    Rect frame = { 0, 0, mWidth, mHeight };
+    uint8_t pixel[4];
+    if(level != NULL)
+    {
+        const Level& layout = *level->level;
+        for(int i = 0; i < layout.size(); i++)
+        {
+            if((level->alive[i >> 6] >> (i & 63)) & 1)
+            {
+                toPixel(layout.color(i), pixel);
+                fillRect(pixels, pitch, mBytesPerPixel, intersect(toFrame(layout.rect(i)), frame), pixel);
+            }
+        }
+        return;
+    }
+
+    for(int brick = 0; brick < ClassicBoard::BRICKS; brick++)
+    {
+        if(!((state.bricks >> brick) & 1))
+        {
+            continue;
+        }
+        toPixel(ClassicBoard::color(brick), pixel);
+        fillRect(pixels, pitch, mBytesPerPixel, intersect(toFrame(ClassicBoard::rect(brick)), frame), pixel);
+    }
+}
+
+void SoftRaster::drawPaddle(uint8_t* pixels, int pitch, const Rect& paddle) const
+{
+    Rect frame = { 0, 0, mWidth, mHeight };
+    uint8_t pixel[4];
+    toPixel(PADDLE_COLOR, pixel);
+    fillRect(pixels, pitch, mBytesPerPixel, intersect(paddle, frame), pixel);
+}
+
+void SoftRaster::drawDot(uint8_t* pixels, int pitch, const Rect& dot) const
+{
+    Rect frame = { 0, 0, mWidth, mHeight };
+    Rect r = intersect(dot, frame);
+    if(mSpriteW == 0)
+    {
+        drawPaddle(pixels, pitch, r);
+        return;
+    }
+
+    //Blend the rows of the sprite left inside the frame
+    for(int y = r.y; y < r.y + r.h; y++)
+    {
+        int i = ((y - dot.y) * mSpriteW + r.x - dot.x) * mBytesPerPixel;
+        blendRow(pixels + y * pitch + r.x * mBytesPerPixel, &mSprite[i], &mSpriteWeight[i], r.w * mBytesPerPixel);
+    }
+}
+
+void SoftRaster::drawLabels(uint8_t* pixels, int pitch, const GameState& state, const Rect& clip) const
+{
+    if(!mHasFont || clip.w <= 0 || clip.h <= 0)
+    {
+        return;
+    }
+
+    //Same labels and places as the front end
+    char text[32];
+    snprintf(text, sizeof(text), "Score:%d", state.score);
+    drawText(pixels, pitch, 5, 5, text, clip);
+    snprintf(text, sizeof(text), "Lives:%d", state.lives);
+    drawText(pixels, pitch, 320, 5, text, clip);
+    if(!mMessage.empty())
+    {
+        drawText(pixels, pitch, 5, (SCREEN_HEIGHT / 2) + 20, mMessage.c_str(), clip);
+    }
+}
+
+void SoftRaster::drawText(uint8_t* pixels, int pitch, int x, int y, const char* text, const Rect& clip) const
+{
+    int penX = x;
+    for(const char* c = text; *c != '\0'; c++)
+    {
+        int ch = (unsigned char)*c;
+        if(ch >= SOFT_GLYPHS)
+        {
+            continue;
+        }
+
+        Rect glyph = { toFrame(penX), toFrame(y), mGlyphW[ch], mGlyphH[ch] };
+        Rect r = intersect(glyph, clip);
+        for(int row = r.y; row < r.y + r.h; row++)
+        {
+            const uint8_t* weight = &mGlyphWeights[mGlyphOffset[ch] + ((row - glyph.y) * glyph.w + r.x - glyph.x) * mBytesPerPixel];
+            blendRow(pixels + row * pitch + r.x * mBytesPerPixel, &mTextRow[0], weight, r.w * mBytesPerPixel);
+        }
+
+        penX += mFont.advance[ch];
+    }
+}
+
+void SoftRaster::render(const GameState& state, const LevelState* level)
+{
+    //Redraw the wall and labels only when a brick went or a label changed
+    const Level* layout = level != NULL ? level->level : NULL;
+    bool stale = !mBackgroundValid || layout != mBackgroundLevel
+              || (layout != NULL ? state.bricksLeft != mBackgroundLeft : state.bricks != mBackgroundBricks)
+              || (mHasFont && (state.score != mBackgroundScore || state.lives != mBackgroundLives));
+    if(stale)
+    {
+        Rect frame = { 0, 0, mWidth, mHeight };
+        fillRect(&mBackground[0], mPitch, mBytesPerPixel, frame, mClearPixel);
+        drawWall(&mBackground[0], mPitch, state, level);
+        drawLabels(&mBackground[0], mPitch, state, frame);
+        memcpy(&mFrame[0], &mBackground[0], mBackground.size());
+
+        mBackgroundValid = true;
+        mBackgroundBricks = state.bricks;
+        mBackgroundLeft = state.bricksLeft;
+        mBackgroundLevel = layout;
+        mBackgroundScore = state.score;
+        mBackgroundLives = state.lives;
+    }
+    else
+    {
+        //Put back what the paddle and dot covered
+        for(int i = 0; i < 2; i++)
+        {
+            const Rect& r = mDrawn[i];
+            for(int y = r.y; y < r.y + r.h; y++)
+            {
+                memcpy(&mFrame[y * mPitch + r.x * mBytesPerPixel], &mBackground[y * mPitch + r.x * mBytesPerPixel], r.w * mBytesPerPixel);
+            }
+        }
+    }
+
+    //Labels stay on top of the paddle and dot
+    Rect frame = { 0, 0, mWidth, mHeight };
+    Rect paddle = paddleBox(state);
+    Rect dot = dotBox(state);
+    drawPaddle(&mFrame[0], mPitch, paddle);
+    drawDot(&mFrame[0], mPitch, dot);
+    mDrawn[0] = intersect(paddle, frame);
+    mDrawn[1] = intersect(dot, frame);
+    drawLabels(&mFrame[0], mPitch, state, mDrawn[0]);
+    drawLabels(&mFrame[0], mPitch, state, mDrawn[1]);
+}
+
+void SoftRaster::renderInto(uint8_t* pixels, int pitch, const GameState& state, const LevelState* level) const
+{
+    Rect frame = { 0, 0, mWidth, mHeight };
+    fillRect(pixels, pitch, mBytesPerPixel, frame, mClearPixel);
+    drawWall(pixels, pitch, state, level);
+    drawPaddle(pixels, pitch, paddleBox(state));
+    drawDot(pixels, pitch, dotBox(state));
+    drawLabels(pixels, pitch, state, frame);
+}
+
+const uint8_t* SoftRaster::pixels() const
+{
+    return &mFrame[0];
+}
+
+int SoftRaster::width() const
+{
+    return mWidth;
+}
+
+int SoftRaster::height() const
+{
+    return mHeight;
+}
+
+int SoftRaster::pitch() const
+{
+    return mPitch;
+}
+
+int SoftRaster::bytesPerPixel() const
+{
+    return mBytesPerPixel;
+}
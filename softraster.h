@@ -0,0 +1,147 @@
+//CPU framebuffer renderer for headless pixel observations, drawing the same frame as the SDL front end without a GPU
+#ifndef SOFTRASTER_H
+#define SOFTRASTER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "game.h"
+#include "level.h"
+
+//Pixel layouts the rasterizer writes
+enum SoftFormat
+{
+    //Four bytes per pixel, R G B A in memory like SDL_PIXELFORMAT_RGBA32
+    SOFT_RGBA = 0,
+
+    //One byte of luminance per pixel
+    SOFT_GRAY = 1
+};
+
+//Characters a font can hold, the ASCII range
+const int SOFT_GLYPHS = 128;
+
+//Glyph coverage of a font, so labels are drawn without SDL_ttf
+struct SoftFont
+{
+    //One byte of coverage per atlas pixel, 0 to 255
+    std::vector<uint8_t> coverage;
+    int width, height;
+
+    //Atlas rectangle and pen advance of each character, empty for those missing
+    Rect glyphs[SOFT_GLYPHS];
+    int advance[SOFT_GLYPHS];
+};
+
+class SoftRaster
+{
+    public:
+        //Initializes a full size RGBA rasterizer
+        SoftRaster();
+
+        //Renders the screen divided by scale, in a pixel format; drops the cached layers.
+        //Returns false for a scale below 1.
+        bool init(int scale, SoftFormat format);
+
+        //Sets the sprite of the dot from RGBA32 pixels, transparent where alpha is 0.
+        //Without a sprite the dot is drawn as a black box.
+        void setSprite(const uint8_t* rgba, int width, int height, int pitch);
+
+        //Loads the sprite from an uncompressed 24 or 32 bit BMP, cyan pixels transparent as with the SDL color key
+        bool loadSprite(const char* path);
+
+        //Sets the font of the labels; without one no labels are drawn
+        void setFont(const SoftFont& font);
+
+        //Sets the message shown under the wall, NULL for none
+        void setMessage(const char* text);
+
+        //Draws a frame into the own framebuffer. The wall and labels are redrawn only when they change,
+        //otherwise just the areas the dot and paddle moved off are restored.
+        void render(const GameState& state, const LevelState* level = NULL);
+
+        //Draws a whole frame into caller memory of height() rows, pitch bytes apart, leaving the own framebuffer alone.
+        //Only reads the rasterizer, so one may serve many games on many threads.
+        void renderInto(uint8_t* pixels, int pitch, const GameState& state, const LevelState* level = NULL) const;
+
+        //The framebuffer drawn by render
+        const uint8_t* pixels() const;
+
+        //Frame dimensions
+        int width() const;
+        int height() const;
+        int pitch() const;
+        int bytesPerPixel() const;
+
+    private:
+        //Maps a screen coordinate to a frame coordinate
+        int toFrame(int c) const;
+        Rect toFrame(const Rect& r) const;
+
+        //Converts a 0xRRGGBBAA color to the bytes of a pixel
+        void toPixel(uint32_t color, uint8_t* pixel) const;
+
+        //Rebuilds the scaled sprite and glyphs from their sources
+        void prepareSprite();
+        void prepareFont();
+
+        //Drawing steps of a frame, clipped to the frame
+        void drawWall(uint8_t* pixels, int pitch, const GameState& state, const LevelState* level) const;
+        void drawPaddle(uint8_t* pixels, int pitch, const Rect& paddle) const;
+        void drawDot(uint8_t* pixels, int pitch, const Rect& dot) const;
+        void drawLabels(uint8_t* pixels, int pitch, const GameState& state, const Rect& clip) const;
+        void drawText(uint8_t* pixels, int pitch, int x, int y, const char* text, const Rect& clip) const;
+
+        //Frame boxes of the paddle and dot
+        Rect paddleBox(const GameState& state) const;
+        Rect dotBox(const GameState& state) const;
+
+        //Frame layout
+        int mScale;
+        SoftFormat mFormat;
+        int mBytesPerPixel;
+        int mWidth;
+        int mHeight;
+        int mPitch;
+
+        //Pixels of the background and text colors
+        uint8_t mClearPixel[4];
+        uint8_t mTextPixel[4];
+
+        //Sprite as given, and scaled to the frame: pixels and per byte weights of 0 to 128
+        std::vector<uint8_t> mSpriteSource;
+        int mSpriteSourceW, mSpriteSourceH;
+        std::vector<uint8_t> mSprite;
+        std::vector<uint8_t> mSpriteWeight;
+        int mSpriteW, mSpriteH;
+
+        //Font as given, and each glyph scaled to the frame as per byte weights
+        SoftFont mFont;
+        bool mHasFont;
+        std::vector<uint8_t> mGlyphWeights;
+        int mGlyphOffset[SOFT_GLYPHS];
+        int mGlyphW[SOFT_GLYPHS];
+        int mGlyphH[SOFT_GLYPHS];
+
+        //A row of text color as wide as the widest glyph, blended through the glyph weights
+        std::vector<uint8_t> mTextRow;
+
+        std::string mMessage;
+
+        //Framebuffer, and the wall and labels it is restored from
+        std::vector<uint8_t> mFrame;
+        std::vector<uint8_t> mBackground;
+
+        //What the background was drawn from
+        bool mBackgroundValid;
+        uint64_t mBackgroundBricks;
+        int mBackgroundLeft;
+        const Level* mBackgroundLevel;
+        int mBackgroundScore;
+        int mBackgroundLives;
+
+        //Boxes the paddle and dot were drawn in by the last render
+        Rect mDrawn[2];
+};
+
+#endif
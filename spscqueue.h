@@ -0,0 +1,54 @@
+//Lock free bounded queue for one producer thread and one consumer thread
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+
+//Size must be a power of two; one slot stays empty to tell a full queue from an empty one
+template<class T, int Size>
+class SpscQueue
+{
+    public:
+        //Initializes an empty queue
+        SpscQueue()
+        {
+            mHead.store(0);
+            mTail.store(0);
+        }
+
+        //Producer side: adds an item, false when the queue is full
+        bool push(const T& item)
+        {
+            unsigned tail = mTail.load(std::memory_order_relaxed);
+            unsigned next = (tail + 1) & (Size - 1);
+            if(next == mHead.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+            mItems[tail] = item;
+            mTail.store(next, std::memory_order_release);
+            return true;
+        }
+
+        //Consumer side: takes the oldest item, false when the queue is empty
+        bool pop(T& item)
+        {
+            unsigned head = mHead.load(std::memory_order_relaxed);
+            if(head == mTail.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+            item = mItems[head];
+            mHead.store((head + 1) & (Size - 1), std::memory_order_release);
+            return true;
+        }
+
+    private:
+        T mItems[Size];
+
+        //Next item to take and next slot to fill, on separate cache lines so the two threads don't share one
+        alignas(64) std::atomic<unsigned> mHead;
+        alignas(64) std::atomic<unsigned> mTail;
+};
+
+#endif
@@ -0,0 +1,285 @@
+//Thread pool for parallel loops
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(int threads)
+{
+    //Initialize
+    mFunction = NULL;
+    mWorkerFunction = NULL;
+    mContext = NULL;
+    mCount = 0;
+    mGrain = 1;
+    mNext = 0;
+    mGeneration = 0;
+    mBusy = 0;
+    mQuit = false;
+
+    if(threads <= 0)
+    {
+        threads = (int)std::thread::hardware_concurrency();
+        if(threads <= 0)
+        {
+            threads = 1;
+        }
+    }
+
+    mSlices = new Slice[threads];
+    for(int i = 0; i < threads; i++)
+    {
+        mSlices[i].range = 0;
+    }
+
+    //The calling thread is one of the threads, and takes index 0
+    for(int i = 1; i < threads; i++)
+    {
+        mWorkers.push_back(std::thread(&ThreadPool::work, this, i));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+    }
+    mWake.notify_all();
+
+    for(size_t i = 0; i < mWorkers.size(); i++)
+    {
+        mWorkers[i].join();
+    }
+    delete[] mSlices;
+}
+
+int ThreadPool::size() const
+{
+    return (int)mWorkers.size() + 1;
+}
+
+void ThreadPool::runChunks()
+{
+    for(;;)
+    {
+        int begin = mNext.fetch_add(mGrain);
+        if(begin >= mCount)
+        {
+            break;
+        }
+        int end = begin + mGrain < mCount ? begin + mGrain : mCount;
+        mFunction(mContext, begin, end);
+    }
+}
+
+//Packs a range into a slice value
+static uint64_t packRange(int begin, int end)
+{
+    return ((uint64_t)(uint32_t)begin << 32) | (uint32_t)end;
+}
+
+bool ThreadPool::takeChunk(int slice, int& begin, int& end)
+{
+    std::atomic<uint64_t>& range = mSlices[slice].range;
+    uint64_t value = range.load();
+    for(;;)
+    {
+        begin = (int)(value >> 32);
+        end = (int)(uint32_t)value;
+        if(begin >= end)
+        {
+            return false;
+        }
+
+        //Thieves only shrink the end, so a failed exchange just means trying again with the new value
+        int next = end - begin > mGrain ? begin + mGrain : end;
+        if(range.compare_exchange_weak(value, packRange(next, end)))
+        {
+            end = next;
+            return true;
+        }
+    }
+}
+
+bool ThreadPool::stealHalf(int victim, int& begin, int& end)
+{
+    std::atomic<uint64_t>& range = mSlices[victim].range;
+    uint64_t value = range.load();
+    for(;;)
+    {
+        int first = (int)(value >> 32);
+        int last = (int)(uint32_t)value;
+
+        //Leave a single chunk to its owner
+        if(last - first <= mGrain)
+        {
+            return false;
+        }
+
+        int middle = first + (last - first + 1) / 2;
+        if(range.compare_exchange_weak(value, packRange(first, middle)))
+        {
+            begin = middle;
+            end = last;
+            return true;
+        }
+    }
+}
+
+void ThreadPool::runStealing(int worker)
+{
+    int threads = size();
+    for(;;)
+    {
+        int begin, end;
+        while(takeChunk(worker, begin, end))
+        {
+            mWorkerFunction(mContext, worker, begin, end);
+        }
+
+        //Out of work: rob the thread with the most left, the slice is only ever written by its owner when empty
+        int victim = -1;
+        int most = mGrain;
+        for(int i = 0; i < threads; i++)
+        {
+            uint64_t value = mSlices[i].range.load(std::memory_order_relaxed);
+            int left = (int)(uint32_t)value - (int)(value >> 32);
+            if(i != worker && left > most)
+            {
+                victim = i;
+                most = left;
+            }
+        }
+        if(victim < 0)
+        {
+            return;
+        }
+        if(stealHalf(victim, begin, end))
+        {
+            mSlices[worker].range.store(packRange(begin, end));
+        }
+    }
+}
+
+void ThreadPool::work(int worker)
+{
+    unsigned seen = 0;
+    for(;;)
+    {
+        //Sleep until a new loop starts
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            while(!mQuit && mGeneration == seen)
+            {
+                mWake.wait(lock);
+            }
+            if(mQuit)
+            {
+                return;
+            }
+            seen = mGeneration;
+        }
+
+        if(mWorkerFunction != NULL)
+        {
+            runStealing(worker);
+        }
+        else
+        {
+            runChunks();
+        }
+
+        //Report back
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mBusy--;
+        }
+        mDone.notify_one();
+    }
+}
+
+void ThreadPool::parallelFor(int count, int grain, RangeFunction fn, void* context)
+{
+    if(count <= 0)
+    {
+        return;
+    }
+    if(grain < 1)
+    {
+        grain = 1;
+    }
+
+    //Small loops are not worth waking anyone
+    if(mWorkers.empty() || count <= grain)
+    {
+        fn(context, 0, count);
+        return;
+    }
+
+    mFunction = fn;
+    mWorkerFunction = NULL;
+    mContext = context;
+    runLoop(count, grain);
+}
+
+void ThreadPool::parallelSteal(int count, int grain, WorkerRangeFunction fn, void* context)
+{
+    if(count <= 0)
+    {
+        return;
+    }
+    if(grain < 1)
+    {
+        grain = 1;
+    }
+
+    //Small loops are not worth waking anyone
+    if(mWorkers.empty() || count <= grain)
+    {
+        for(int begin = 0; begin < count; begin += grain)
+        {
+            fn(context, 0, begin, begin + grain < count ? begin + grain : count);
+        }
+        return;
+    }
+
+    //Even slices to start from
+    int threads = size();
+    for(int i = 0; i < threads; i++)
+    {
+        mSlices[i].range = packRange((int)((int64_t)count * i / threads), (int)((int64_t)count * (i + 1) / threads));
+    }
+
+    mFunction = NULL;
+    mWorkerFunction = fn;
+    mContext = context;
+    runLoop(count, grain);
+}
+
+void ThreadPool::runLoop(int count, int grain)
+{
+    //Publish the loop and wake the workers; the lock also publishes the functions and slices set before
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCount = count;
+        mGrain = grain;
+        mNext = 0;
+        mBusy = (int)mWorkers.size();
+        mGeneration++;
+    }
+    mWake.notify_all();
+
+    //Help out, then wait for the stragglers
+    if(mWorkerFunction != NULL)
+    {
+        runStealing(0);
+    }
+    else
+    {
+        runChunks();
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    while(mBusy > 0)
+    {
+        mDone.wait(lock);
+    }
+}
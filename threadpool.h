@@ -0,0 +1,88 @@
+//Persistent worker threads for splitting loops across cores
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Body of a parallel loop, called with a half open range of indices
+typedef void (*RangeFunction)(void* context, int begin, int end);
+
+//Body of a work stealing loop, also told which thread runs it, from 0 (the caller) to size() - 1
+typedef void (*WorkerRangeFunction)(void* context, int worker, int begin, int end);
+
+class ThreadPool
+{
+    public:
+        //Starts the workers, 0 uses one per hardware thread; the calling thread always helps
+        ThreadPool(int threads = 0);
+
+        //Stops and joins the workers
+        ~ThreadPool();
+
+        //Runs fn over [0, count) in chunks of at most grain indices and returns when all are done.
+        //Chunks are claimed dynamically, so callers must not depend on which thread runs which chunk.
+        void parallelFor(int count, int grain, RangeFunction fn, void* context);
+
+        //Runs fn over [0, count) in chunks of at most grain indices, for items of uneven cost.
+        //Every thread starts on its own slice of the range and, once done, steals the back half of the
+        //largest slice left, so there is no shared counter and neighbouring items stay on one thread.
+        //The worker index lets fn keep per thread data without locking.
+        void parallelSteal(int count, int grain, WorkerRangeFunction fn, void* context);
+
+        //Number of threads taking part in a loop, including the caller
+        int size() const;
+
+    private:
+        //Worker thread body
+        void work(int worker);
+
+        //Publishes a loop, helps run it and waits for the workers
+        void runLoop(int count, int grain);
+
+        //Claims and runs chunks of the current loop until none are left
+        void runChunks();
+
+        //Runs the chunks of a thread's own slice, then steals from the others until none are left
+        void runStealing(int worker);
+
+        //Takes the next chunk from the front of a slice, or the back half of a slice for another thread
+        bool takeChunk(int slice, int& begin, int& end);
+        bool stealHalf(int victim, int& begin, int& end);
+
+        std::vector<std::thread> mWorkers;
+        std::mutex mMutex;
+        std::condition_variable mWake;
+        std::condition_variable mDone;
+
+        //Current loop, one of the two functions is set
+        RangeFunction mFunction;
+        WorkerRangeFunction mWorkerFunction;
+        void* mContext;
+        int mCount;
+        int mGrain;
+        std::atomic<int> mNext;
+
+        //Remaining range of each thread in a work stealing loop, begin in the high half and end in the low half.
+        //Padded so threads taking from their own slices don't share cache lines.
+        struct Slice
+        {
+            std::atomic<uint64_t> range;
+            char padding[64 - sizeof(std::atomic<uint64_t>)];
+        };
+        Slice* mSlices;
+
+        //Loop generation, bumped for every loop so sleeping workers notice new work
+        unsigned mGeneration;
+
+        //Workers still inside the current loop
+        int mBusy;
+
+        bool mQuit;
+};
+
+#endif
@@ -0,0 +1,342 @@
+//Ranks scripted paddle bots by playing whole games of each over many seeds and launch speeds on every core
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "game.h"
+#include "threadpool.h"
+
+using namespace std;
+
+//Picks the paddle move of a tick: -1 left, 0 stay, 1 right
+typedef int (*BotFunction)(const GameState& state);
+
+struct Bot
+{
+    const char* name;
+    BotFunction decide;
+};
+
+//Totals of the games one bot played, kept per thread and merged at the end
+struct BotStats
+{
+    long long games;
+    long long wins;
+    long long score;
+    long long livesLost;
+    long long bricks;
+    long long ticks;
+
+    //Ticks the won games took to clear the wall
+    long long ticksToClear;
+};
+
+//Moves the paddle centre towards an x position
+static int moveTowards(const GameState& state, float x)
+{
+    int target = (int)x - PADDLE_WIDTH / 2;
+    if(state.paddle.x < target - PADDLE_VEL / 2)
+    {
+        return 1;
+    }
+    if(state.paddle.x > target + PADDLE_VEL / 2)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+//Never moves
+static int idleBot(const GameState&)
+{
+    return 0;
+}
+
+//Keeps the paddle under the dot
+static int followBot(const GameState& state)
+{
+    return moveTowards(state, state.ball.x + DOT_WIDTH / 2);
+}
+
+//Only chases a falling dot in the bottom half, otherwise stays put
+static int lazyBot(const GameState& state)
+{
+    if(state.ball.velY > 0 && state.ball.y > SCREEN_HEIGHT / 2)
+    {
+        return followBot(state);
+    }
+    return 0;
+}
+
+//Waits where a falling dot will reach the paddle, folding its path off the side walls; centres otherwise
+static int predictBot(const GameState& state)
+{
+    const Ball& ball = state.ball;
+    if(ball.velY <= 0)
+    {
+        return moveTowards(state, SCREEN_WIDTH / 2);
+    }
+
+    float ticks = (state.paddle.y - (ball.y + DOT_HEIGHT)) / ball.velY;
+    float span = SCREEN_WIDTH - DOT_WIDTH;
+    float x = fmodf(ball.x + ball.velX * ticks, 2 * span);
+    if(x < 0)
+    {
+        x += 2 * span;
+    }
+    if(x > span)
+    {
+        x = 2 * span - x;
+    }
+    return moveTowards(state, x + DOT_WIDTH / 2);
+}
+
+//Moves at random, as a baseline
+static int randomBot(const GameState& state)
+{
+    uint32_t bits = state.tick * 0x9E3779B1u ^ (uint32_t)state.score * 0x85EBCA77u;
+    bits ^= bits >> 15;
+    return (int)(bits % 3) - 1;
+}
+
+static const Bot BOTS[] =
+{
+    { "idle", idleBot },
+    { "random", randomBot },
+    { "lazy", lazyBot },
+    { "follow", followBot },
+    { "predict", predictBot }
+};
+static const int BOT_COUNT = sizeof(BOTS) / sizeof(BOTS[0]);
+
+//The games to play: every bot against every seed at every launch speed
+struct Tournament
+{
+    vector<int> bots;
+    vector<float> speeds;
+    int seeds;
+    uint32_t firstSeed;
+    uint32_t maxTicks;
+
+    //Statistics of each thread, one entry per bot
+    vector< vector<BotStats> > perThread;
+};
+
+//Plays one complete game
+static void playGame(const Tournament& tournament, int game, BotStats& stats)
+{
+    int seedIndex = game % tournament.seeds;
+    int speedIndex = game / tournament.seeds % (int)tournament.speeds.size();
+    const Bot& bot = BOTS[tournament.bots[game / tournament.seeds / (int)tournament.speeds.size()]];
+
+    GameState state;
+    initGame(state, tournament.firstSeed + seedIndex);
+    state.ball.velY = tournament.speeds[speedIndex];
+
+    GameInput input = { 0 };
+    while(!gameOver(state) && !gameWon(state) && state.tick < tournament.maxTicks)
+    {
+        input.paddleMove = bot.decide(state);
+        step(state, input);
+    }
+
+    stats.games++;
+    stats.score += state.score;
+    stats.livesLost += START_LIVES - state.lives;
+    stats.bricks += BRICK_NUMBER - state.bricksLeft;
+    stats.ticks += state.tick;
+    if(gameWon(state))
+    {
+        stats.wins++;
+        stats.ticksToClear += state.tick;
+    }
+}
+
+//Plays a range of games into the statistics of the thread running it
+static void playRange(void* context, int worker, int begin, int end)
+{
+    Tournament& tournament = *(Tournament*)context;
+    vector<BotStats>& stats = tournament.perThread[worker];
+    int perBot = tournament.seeds * (int)tournament.speeds.size();
+    for(int game = begin; game < end; game++)
+    {
+        playGame(tournament, game, stats[game / perBot]);
+    }
+}
+
+//Reads a comma separated list of numbers
+static vector<float> parseList(const char* text)
+{
+    vector<float> values;
+    for(const char* p = text; *p != '\0'; )
+    {
+        char* end;
+        values.push_back(strtof(p, &end));
+        p = *end == ',' ? end + 1 : end;
+        if(end == p && *p != '\0')
+        {
+            break;
+        }
+    }
+    return values;
+}
+
+int main(int argc, char* args[])
+{
+    Tournament tournament;
+    tournament.seeds = 1000;
+    tournament.firstSeed = 1;
+    tournament.maxTicks = TICKS_PER_SECOND * 60 * 10;
+    tournament.speeds.push_back(3);
+    int threads = 0;
+    int grain = 8;
+
+    for(int i = 1; i < argc; i++)
+    {
+        //Seeds played by each bot at each speed
+        if(strcmp(args[i], "--seeds") == 0 && i + 1 < argc)
+        {
+            tournament.seeds = atoi(args[++i]);
+        }
+        else if(strcmp(args[i], "--first-seed") == 0 && i + 1 < argc)
+        {
+            tournament.firstSeed = (uint32_t)strtoul(args[++i], NULL, 10);
+        }
+        //Vertical launch speeds, the seed picks the sideways one
+        else if(strcmp(args[i], "--speeds") == 0 && i + 1 < argc)
+        {
+            tournament.speeds = parseList(args[++i]);
+        }
+        //Games still running after this many ticks are stopped where they are
+        else if(strcmp(args[i], "--max-ticks") == 0 && i + 1 < argc)
+        {
+            tournament.maxTicks = (uint32_t)strtoul(args[++i], NULL, 10);
+        }
+        else if(strcmp(args[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = atoi(args[++i]);
+        }
+        else if(strcmp(args[i], "--grain") == 0 && i + 1 < argc)
+        {
+            grain = atoi(args[++i]);
+        }
+        //Only the named bots
+        else if(strcmp(args[i], "--bot") == 0 && i + 1 < argc)
+        {
+            const char* name = args[++i];
+            int found = -1;
+            for(int b = 0; b < BOT_COUNT; b++)
+            {
+                if(strcmp(BOTS[b].name, name) == 0)
+                {
+                    found = b;
+                }
+            }
+            if(found < 0)
+            {
+                printf("Unknown bot %s\n", name);
+                return 1;
+            }
+            tournament.bots.push_back(found);
+        }
+        else
+        {
+            printf("Usage: %s [--seeds n] [--first-seed n] [--speeds 3,4,5] [--max-ticks n] [--threads n] [--grain games] [--bot name]...\n", args[0]);
+            printf("Bots:");
+            for(int b = 0; b < BOT_COUNT; b++)
+            {
+                printf(" %s", BOTS[b].name);
+            }
+            printf("\n");
+            return 1;
+        }
+    }
+
+    if(tournament.bots.empty())
+    {
+        for(int b = 0; b < BOT_COUNT; b++)
+        {
+            tournament.bots.push_back(b);
+        }
+    }
+    if(tournament.seeds <= 0 || tournament.speeds.empty())
+    {
+        printf("Nothing to play!\n");
+        return 1;
+    }
+
+    ThreadPool pool(threads);
+    int games = (int)tournament.bots.size() * tournament.seeds * (int)tournament.speeds.size();
+    BotStats zero = BotStats();
+    tournament.perThread.assign(pool.size(), vector<BotStats>(tournament.bots.size(), zero));
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    pool.parallelSteal(games, grain, playRange, &tournament);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    //Merge the threads' statistics
+    vector<BotStats> total(tournament.bots.size(), zero);
+    long long ticks = 0;
+    for(size_t t = 0; t < tournament.perThread.size(); t++)
+    {
+        for(size_t b = 0; b < total.size(); b++)
+        {
+            const BotStats& s = tournament.perThread[t][b];
+            total[b].games += s.games;
+            total[b].wins += s.wins;
+            total[b].score += s.score;
+            total[b].livesLost += s.livesLost;
+            total[b].bricks += s.bricks;
+            total[b].ticks += s.ticks;
+            total[b].ticksToClear += s.ticksToClear;
+            ticks += s.ticks;
+        }
+    }
+
+    //Best mean score first, then the fewest lives lost, then the quickest clear.
+    //A bot that never cleared the wall has no clear time and goes after those that did.
+    vector<int> order(total.size());
+    for(size_t b = 0; b < order.size(); b++)
+    {
+        order[b] = (int)b;
+    }
+    stable_sort(order.begin(), order.end(), [&](int a, int b)
+    {
+        const BotStats& x = total[a];
+        const BotStats& y = total[b];
+        if(x.score * y.games != y.score * x.games)
+        {
+            return x.score * y.games > y.score * x.games;
+        }
+        if(x.livesLost * y.games != y.livesLost * x.games)
+        {
+            return x.livesLost * y.games < y.livesLost * x.games;
+        }
+        if(x.wins == 0 || y.wins == 0)
+        {
+            return x.wins > y.wins;
+        }
+        return x.ticksToClear * y.wins < y.ticksToClear * x.wins;
+    });
+
+    printf("%-4s %-10s %8s %8s %10s %10s %14s %12s\n", "rank", "bot", "games", "won", "score", "livesLost", "ticksToClear", "bricks/s");
+    for(size_t r = 0; r < order.size(); r++)
+    {
+        const BotStats& s = total[order[r]];
+        char clear[32] = "n/a";
+        if(s.wins > 0)
+        {
+            snprintf(clear, sizeof(clear), "%.0f", (double)s.ticksToClear / s.wins);
+        }
+        double bricksPerSecond = s.ticks > 0 ? (double)s.bricks * TICKS_PER_SECOND / s.ticks : 0;
+        printf("%-4d %-10s %8lld %7.1f%% %10.2f %10.2f %14s %12.3f\n", (int)r + 1, BOTS[tournament.bots[order[r]]].name, s.games,
+               100.0 * s.wins / s.games, (double)s.score / s.games, (double)s.livesLost / s.games, clear, bricksPerSecond);
+    }
+
+    printf("\n%d games, %lld ticks in %.2f s on %d threads: %.0f games/s, %.1f M ticks/s\n", games, ticks, seconds, pool.size(),
+           games / seconds, ticks / seconds / 1e6);
+    return 0;
+}
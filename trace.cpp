@@ -0,0 +1,124 @@
+//Per-thread trace rings and the trace event writer
+#include "trace.h"
+#include <stdio.h>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> gTraceEnabled(false);
+
+//One finished span
+struct TraceEvent
+{
+    const char* name;
+    uint64_t start;
+    uint64_t duration;
+};
+
+//Events of one thread, written only by that thread
+struct TraceRing
+{
+    TraceEvent events[TRACE_RING_SIZE];
+
+    //Events recorded so far, the ring holds the last TRACE_RING_SIZE of them
+    uint64_t written;
+
+    //Thread id and name shown in the trace
+    int tid;
+    const char* name;
+};
+
+//Every ring ever created; rings are kept until exit so threads that ended still show up
+static std::vector<TraceRing*> gRings;
+static std::mutex gRingsMutex;
+
+//Ring of the calling thread, created on its first event
+static thread_local TraceRing* tRing = NULL;
+
+//Time zero of the trace
+static const std::chrono::steady_clock::time_point gTraceEpoch = std::chrono::steady_clock::now();
+
+//Returns the ring of the calling thread, registering a new one if needed
+static TraceRing* threadRing()
+{
+    if(tRing == NULL)
+    {
+        TraceRing* ring = new TraceRing();
+        ring->written = 0;
+        ring->name = NULL;
+
+        std::lock_guard<std::mutex> lock(gRingsMutex);
+        ring->tid = (int)gRings.size() + 1;
+        gRings.push_back(ring);
+        tRing = ring;
+    }
+    return tRing;
+}
+
+void traceEnable(bool enable)
+{
+    gTraceEnabled.store(enable, std::memory_order_relaxed);
+}
+
+uint64_t traceNow()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - gTraceEpoch).count();
+}
+
+void traceRecord(const char* name, uint64_t start, uint64_t end)
+{
+    TraceRing* ring = threadRing();
+    TraceEvent& e = ring->events[ring->written % TRACE_RING_SIZE];
+    e.name = name;
+    e.start = start;
+    e.duration = end - start;
+    ring->written++;
+}
+
+void traceThreadName(const char* name)
+{
+    threadRing()->name = name;
+}
+
+bool traceWrite(const char* path)
+{
+    FILE* file = fopen(path, "w");
+    if(file == NULL)
+    {
+        printf("Unable to create trace %s!\n", path);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(gRingsMutex);
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for(size_t r = 0; r < gRings.size(); r++)
+    {
+        const TraceRing* ring = gRings[r];
+        if(ring->name != NULL)
+        {
+            fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", ring->tid, ring->name);
+            first = false;
+        }
+
+        //Oldest surviving event first; timestamps are in microseconds
+        uint64_t begin = ring->written > (uint64_t)TRACE_RING_SIZE ? ring->written - TRACE_RING_SIZE : 0;
+        for(uint64_t i = begin; i < ring->written; i++)
+        {
+            const TraceEvent& e = ring->events[i % TRACE_RING_SIZE];
+            fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"breakout\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    first ? "" : ",\n", e.name, ring->tid, e.start / 1000.0, e.duration / 1000.0);
+            first = false;
+        }
+    }
+    fprintf(file, "\n]}\n");
+
+    bool success = ferror(file) == 0;
+    fclose(file);
+    if(!success)
+    {
+        printf("Failed to write trace %s!\n", path);
+    }
+    return success;
+}
@@ -0,0 +1,64 @@
+//Scoped phase timers recorded into per-thread ring buffers and written out as Chrome trace events
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <atomic>
+
+//Events kept per thread, the oldest are overwritten once a ring is full
+const int TRACE_RING_SIZE = 16384;
+
+//Recording switch; scopes check it once on entry, so a disabled trace costs a load and a branch
+extern std::atomic<bool> gTraceEnabled;
+
+//Starts or stops recording
+void traceEnable(bool enable);
+
+//Nanoseconds since the program started tracing
+uint64_t traceNow();
+
+//Adds a finished span to the ring of the calling thread; name must outlive the trace (a string literal)
+void traceRecord(const char* name, uint64_t start, uint64_t end);
+
+//Names the calling thread in the trace
+void traceThreadName(const char* name);
+
+//Writes every ring as trace event JSON for chrome://tracing or Perfetto.
+//Call while no other thread is recording.
+bool traceWrite(const char* path);
+
+//Times the enclosing block
+class TraceScope
+{
+    public:
+        TraceScope(const char* name)
+        {
+            mName = name;
+            mActive = gTraceEnabled.load(std::memory_order_relaxed);
+            mStart = mActive ? traceNow() : 0;
+        }
+
+        ~TraceScope()
+        {
+            if(mActive)
+            {
+                traceRecord(mName, mStart, traceNow());
+            }
+        }
+
+    private:
+        const char* mName;
+        uint64_t mStart;
+        bool mActive;
+};
+
+//Times the rest of the enclosing block under the given name; building with BREAKOUT_NO_TRACE removes every trace point
+#ifdef BREAKOUT_NO_TRACE
+#define TRACE_SCOPE(name)
+#else
+#define TRACE_JOIN2(a, b) a##b
+#define TRACE_JOIN(a, b) TRACE_JOIN2(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_JOIN(traceScope, __LINE__)(name)
+#endif
+
+#endif
@@ -0,0 +1,74 @@
+//Lock free triple buffer handing the newest value from one writer thread to one reader thread
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+
+//The writer fills the back slot and swaps it with the middle one, the reader swaps its front slot with the middle one
+//when a new value was published. Neither side ever waits and the reader always sees a whole value.
+template<class T>
+class TripleBuffer
+{
+    public:
+        //Initializes the slot indices
+        TripleBuffer()
+        {
+            mBack = 0;
+            mMiddle.store(1);
+            mFront = 2;
+        }
+
+        //Fills every slot with the same value; only before the threads start
+        void reset(const T& value)
+        {
+            for(int i = 0; i < 3; i++)
+            {
+                mSlots[i] = value;
+            }
+            mMiddle.store(mMiddle.load() & INDEX_MASK);
+        }
+
+        //Writer side: the slot being filled, then making it the newest value
+        T& back()
+        {
+            return mSlots[mBack];
+        }
+
+        void publish()
+        {
+            mBack = mMiddle.exchange(mBack | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+        }
+
+        //Reader side: takes the newest value if one was published since the last call, returns whether it did
+        bool update()
+        {
+            if(!(mMiddle.load(std::memory_order_relaxed) & FRESH_BIT))
+            {
+                return false;
+            }
+            mFront = mMiddle.exchange(mFront, std::memory_order_acq_rel) & INDEX_MASK;
+            return true;
+        }
+
+        //The value the reader holds, stays put until the next update
+        const T& front() const
+        {
+            return mSlots[mFront];
+        }
+
+    private:
+        //Middle index bits, and the flag set while the middle slot holds a value the reader hasn't taken
+        static const int INDEX_MASK = 3;
+        static const int FRESH_BIT = 4;
+
+        T mSlots[3];
+
+        //Slot owned by the writer and by the reader
+        int mBack;
+        int mFront;
+
+        //Slot in between, swapped by both sides
+        std::atomic<int> mMiddle;
+};
+
+#endif
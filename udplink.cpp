@@ -0,0 +1,215 @@
+//Loopback UDP link
+#include "udplink.h"
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#ifdef _WIN32
+#include <winsock2.h>
+typedef int SocketLength;
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef socklen_t SocketLength;
+#endif
+
+//Milliseconds on a steady clock
+static uint64_t nowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//Loopback address on a port
+static sockaddr_in loopback(int port)
+{
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons((uint16_t)port);
+    return address;
+}
+
+UdpLink::UdpLink()
+{
+    //Initialize
+    mSocket = -1;
+    mRemotePort = 0;
+    mLatency = 0;
+    mJitter = 0;
+    mLoss = 0;
+    mRandom = 1;
+    mDelayed.resize(UDP_MAX_DELAYED);
+    mDelayedCount = 0;
+    mSent = 0;
+    mDropped = 0;
+}
+
+UdpLink::~UdpLink()
+{
+    close();
+}
+
+bool UdpLink::open(int localPort, int remotePort)
+{
+    close();
+
+#ifdef _WIN32
+    WSADATA data;
+    if(WSAStartup(MAKEWORD(2, 2), &data) != 0)
+    {
+        printf("Unable to start Winsock!\n");
+        return false;
+    }
+    SOCKET handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if(handle == INVALID_SOCKET)
+    {
+        printf("Unable to create a UDP socket!\n");
+        WSACleanup();
+        return false;
+    }
+    mSocket = (intptr_t)handle;
+    u_long nonBlocking = 1;
+    bool ready = ioctlsocket(handle, FIONBIO, &nonBlocking) == 0;
+#else
+    int handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if(handle < 0)
+    {
+        printf("Unable to create a UDP socket!\n");
+        return false;
+    }
+    mSocket = handle;
+    bool ready = fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK) == 0;
+#endif
+
+    sockaddr_in address = loopback(localPort);
+    if(!ready || bind(handle, (const sockaddr*)&address, sizeof(address)) != 0)
+    {
+        printf("Unable to bind UDP port %d!\n", localPort);
+        close();
+        return false;
+    }
+
+    mRemotePort = remotePort;
+    mDelayedCount = 0;
+    mSent = 0;
+    mDropped = 0;
+    return true;
+}
+
+void UdpLink::close()
+{
+    if(mSocket == -1)
+    {
+        return;
+    }
+#ifdef _WIN32
+    closesocket((SOCKET)mSocket);
+    WSACleanup();
+#else
+    ::close((int)mSocket);
+#endif
+    mSocket = -1;
+}
+
+void UdpLink::setConditions(int latency, int jitter, float lossPercent, uint32_t seed)
+{
+    mLatency = latency;
+    mJitter = jitter;
+    mLoss = lossPercent;
+    mRandom = seed != 0 ? seed : 1;
+}
+
+bool UdpLink::send(const uint8_t* data, int size)
+{
+    if(mSocket == -1 || size > UDP_MAX_PACKET)
+    {
+        return false;
+    }
+    mSent++;
+
+    //Lost on the way, or no room to hold it back
+    if(random() % 10000 < mLoss * 100 || mDelayedCount == UDP_MAX_DELAYED)
+    {
+        mDropped++;
+        return true;
+    }
+
+    Delayed& packet = mDelayed[mDelayedCount++];
+    packet.due = nowMs() + mLatency + (mJitter > 0 ? random() % (mJitter + 1) : 0);
+    packet.size = size;
+    memcpy(packet.data, data, size);
+    flush();
+    return true;
+}
+
+void UdpLink::flush()
+{
+    uint64_t now = nowMs();
+    sockaddr_in address = loopback(mRemotePort);
+    for(int i = 0; i < mDelayedCount; )
+    {
+        Delayed& packet = mDelayed[i];
+        if(packet.due > now)
+        {
+            i++;
+            continue;
+        }
+
+        //A full socket buffer loses the packet like a real network would
+        sendto(mSocket, (const char*)packet.data, packet.size, 0, (const sockaddr*)&address, sizeof(address));
+
+        //Fill the gap with the last one, order among held back packets doesn't matter
+        mDelayedCount--;
+        if(i != mDelayedCount)
+        {
+            packet = mDelayed[mDelayedCount];
+        }
+    }
+}
+
+int UdpLink::receive(uint8_t* data, int capacity)
+{
+    if(mSocket == -1)
+    {
+        return 0;
+    }
+
+    //Only take packets from the peer, anything else on the port is skipped
+    for(;;)
+    {
+        sockaddr_in from;
+        SocketLength length = sizeof(from);
+        int size = (int)recvfrom(mSocket, (char*)data, capacity, 0, (sockaddr*)&from, &length);
+        if(size < 0)
+        {
+            return 0;
+        }
+        if(from.sin_port == htons((uint16_t)mRemotePort))
+        {
+            return size;
+        }
+    }
+}
+
+uint32_t UdpLink::sent() const
+{
+    return mSent;
+}
+
+uint32_t UdpLink::dropped() const
+{
+    return mDropped;
+}
+
+uint32_t UdpLink::random()
+{
+    //Xorshift, plenty for picking drops and delays
+    mRandom ^= mRandom << 13;
+    mRandom ^= mRandom >> 17;
+    mRandom ^= mRandom << 5;
+    return mRandom;
+}
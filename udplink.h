@@ -0,0 +1,75 @@
+//Loopback UDP link that can delay and drop outgoing packets, to try netcode against a bad network on one machine
+#ifndef UDPLINK_H
+#define UDPLINK_H
+
+#include <stdint.h>
+#include <vector>
+
+//Largest packet the link carries
+const int UDP_MAX_PACKET = 512;
+
+//Packets that can be held back at once; more are dropped
+const int UDP_MAX_DELAYED = 256;
+
+class UdpLink
+{
+    public:
+        //Initializes variables
+        UdpLink();
+
+        //Closes the socket
+        ~UdpLink();
+
+        //Binds 127.0.0.1 on a port and sends to another port there
+        bool open(int localPort, int remotePort);
+
+        void close();
+
+        //Holds every outgoing packet back for latency plus up to jitter milliseconds, so packets can overtake each other,
+        //and drops a lossPercent share of them. The seed makes the drops and delays repeatable.
+        void setConditions(int latency, int jitter, float lossPercent, uint32_t seed);
+
+        //Queues a packet, sent by flush once its delay is over
+        bool send(const uint8_t* data, int size);
+
+        //Sends the held back packets that are due, call often
+        void flush();
+
+        //Reads one waiting packet, returns its size or 0 when there is none
+        int receive(uint8_t* data, int capacity);
+
+        //Packets handed to send, and those dropped by the injected loss
+        uint32_t sent() const;
+        uint32_t dropped() const;
+
+    private:
+        //A packet held back until its time comes
+        struct Delayed
+        {
+            uint64_t due;
+            int size;
+            uint8_t data[UDP_MAX_PACKET];
+        };
+
+        //Next number of the link's generator
+        uint32_t random();
+
+        //Socket handle, -1 when closed; wide enough for a Windows SOCKET
+        intptr_t mSocket;
+        int mRemotePort;
+
+        //Injected conditions
+        int mLatency;
+        int mJitter;
+        float mLoss;
+        uint32_t mRandom;
+
+        //Held back packets, preallocated
+        std::vector<Delayed> mDelayed;
+        int mDelayedCount;
+
+        uint32_t mSent;
+        uint32_t mDropped;
+};
+
+#endif
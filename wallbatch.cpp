@@ -0,0 +1,167 @@
+//Batched brick wall renderer
+#include "wallbatch.h"
+#include <algorithm>
+#include "board.h"
+
+//Color from 0xRRGGBBAA
+static SDL_Color toColor( uint32_t c )
+{
+    SDL_Color color = { (Uint8)( c >> 24 ), (Uint8)( c >> 16 ), (Uint8)( c >> 8 ), (Uint8)c };
+    return color;
+}
+
+//Rectangles of every brick of the classic wall, laid out once from its compile time board
+struct ClassicRects
+{
+    SDL_Rect rects[ ClassicBoard::BRICKS ];
+
+    ClassicRects()
+    {
+        for( int i = 0; i < ClassicBoard::BRICKS; i++ )
+        {
+            Rect r = ClassicBoard::rect( i );
+            SDL_Rect rect = { r.x, r.y, r.w, r.h };
+            rects[ i ] = rect;
+        }
+    }
+};
+
+WallBatch::WallBatch()
+{
+    //Initialize
+    mLevel = NULL;
+    mLevelSize = 0;
+    mBricks = 0;
+    mBricksLeft = -1;
+    mValid = false;
+
+    mRects.reserve( BRICK_NUMBER );
+    mRuns.reserve( ROWS );
+}
+
+void WallBatch::invalidate()
+{
+    mValid = false;
+
+    //A level reloaded in place gets its colors looked up again
+    mLevel = NULL;
+}
+
+void WallBatch::update( const GameState& state )
+{
+    //Nothing to do until a brick is destroyed
+    if( mValid && state.bricks == mBricks )
+    {
+        return;
+    }
+
+    //Bricks run in row order and a row shares one color, so a new run starts with each row
+    static const ClassicRects classic;
+    mRects.clear();
+    mRuns.clear();
+    uint32_t runColor = 0;
+    for( int brick = 0; brick < ClassicBoard::BRICKS; brick++ )
+    {
+        if( !( ( state.bricks >> brick ) & 1 ) )
+        {
+            continue;
+        }
+
+        if( mRuns.empty() || ClassicBoard::color( brick ) != runColor )
+        {
+            runColor = ClassicBoard::color( brick );
+            WallRun run = { toColor( runColor ), (int)mRects.size(), 0 };
+            mRuns.push_back( run );
+        }
+        mRects.push_back( classic.rects[ brick ] );
+        mRuns.back().count++;
+    }
+
+    mBricks = state.bricks;
+    mBricksLeft = -1;
+    mValid = true;
+}
+
+void WallBatch::buildPalette( const Level& level )
+{
+    //Sorted distinct colors, then each brick's place among them
+    mPalette.resize( level.size() );
+    for( int i = 0; i < level.size(); i++ )
+    {
+        mPalette[ i ] = level.color( i );
+    }
+    std::sort( mPalette.begin(), mPalette.end() );
+    mPalette.erase( std::unique( mPalette.begin(), mPalette.end() ), mPalette.end() );
+
+    mBrickColor.resize( level.size() );
+    for( int i = 0; i < level.size(); i++ )
+    {
+        mBrickColor[ i ] = (int)( std::lower_bound( mPalette.begin(), mPalette.end(), level.color( i ) ) - mPalette.begin() );
+    }
+
+    mLevel = &level;
+    mLevelSize = level.size();
+}
+
+void WallBatch::update( const Level& level, const uint64_t* alive, int bricksLeft )
+{
+    //Unbreakable bricks never go, so the count of breakable ones left tells when to rebuild
+    if( mValid && bricksLeft == mBricksLeft && mLevel == &level )
+    {
+        return;
+    }
+
+    if( mLevel != &level || mLevelSize != level.size() )
+    {
+        buildPalette( level );
+    }
+
+    //Counting sort of the standing bricks by color, keeping brick order within a color
+    int colors = (int)mPalette.size();
+    mColorFill.assign( colors + 1, 0 );
+    for( int i = 0; i < level.size(); i++ )
+    {
+        if( ( alive[ i >> 6 ] >> ( i & 63 ) ) & 1 )
+        {
+            mColorFill[ mBrickColor[ i ] + 1 ]++;
+        }
+    }
+
+    mRuns.clear();
+    for( int c = 0; c < colors; c++ )
+    {
+        if( mColorFill[ c + 1 ] > 0 )
+        {
+            WallRun run = { toColor( mPalette[ c ] ), mColorFill[ c ], mColorFill[ c + 1 ] };
+            mRuns.push_back( run );
+        }
+        mColorFill[ c + 1 ] += mColorFill[ c ];
+    }
+
+    mRects.resize( mColorFill[ colors ] );
+    for( int i = 0; i < level.size(); i++ )
+    {
+        if( ( alive[ i >> 6 ] >> ( i & 63 ) ) & 1 )
+        {
+            Rect r = level.rect( i );
+            SDL_Rect rect = { r.x, r.y, r.w, r.h };
+            mRects[ mColorFill[ mBrickColor[ i ] ]++ ] = rect;
+        }
+    }
+
+    //No classic mask has every bit set, so switching back to the classic wall rebuilds
+    mBricks = ~(uint64_t)0;
+    mBricksLeft = bricksLeft;
+    mValid = true;
+}
+
+void WallBatch::render( SDL_Renderer* renderer )
+{
+    //One fill per color, however many bricks stand
+    for( size_t i = 0; i < mRuns.size(); i++ )
+    {
+        const WallRun& run = mRuns[ i ];
+        SDL_SetRenderDrawColor( renderer, run.color.r, run.color.g, run.color.b, run.color.a );
+        SDL_RenderFillRects( renderer, &mRects[ run.first ], run.count );
+    }
+}
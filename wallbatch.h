@@ -0,0 +1,57 @@
+//Brick wall drawn as one batched fill per brick color
+#ifndef WALLBATCH_H
+#define WALLBATCH_H
+
+#include <SDL.h>
+#include <vector>
+#include "game.h"
+#include "level.h"
+
+//Bricks of one color, drawn with a single fill call
+struct WallRun
+{
+    SDL_Color color;
+    int first;
+    int count;
+};
+
+class WallBatch
+{
+    public:
+        //Initializes variables
+        WallBatch();
+
+        //Rebuilds the runs if bricks were destroyed since the last update
+        void update( const GameState& state );
+
+        //The same for a level, drawing the bricks set in alive in their own colors
+        void update( const Level& level, const uint64_t* alive, int bricksLeft );
+
+        //Forces a rebuild on the next update
+        void invalidate();
+
+        //Draws every standing brick, one call per color
+        void render( SDL_Renderer* renderer );
+
+    private:
+        //Looks up the colors of a level once, so rebuilds can sort its bricks by color in one pass
+        void buildPalette( const Level& level );
+
+        //Standing bricks grouped by color, and the runs they form
+        std::vector<SDL_Rect> mRects;
+        std::vector<WallRun> mRuns;
+
+        //Distinct colors of the level last drawn as 0xRRGGBBAA, each brick's entry and the bricks per entry
+        const Level* mLevel;
+        int mLevelSize;
+        std::vector<uint32_t> mPalette;
+        std::vector<int> mBrickColor;
+        std::vector<int> mColorFill;
+
+        //Alive mask and bricks left the runs were built from
+        uint64_t mBricks;
+        int mBricksLeft;
+        bool mValid;
+};
+
+#endif